@@ -0,0 +1,130 @@
+#include "AsyncTelemetrySink.h"
+#include <chrono>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const size_t WRITER_BATCH = 4096;
+const unsigned SPIN_BEFORE_SLEEP = 64;
+
+// Incremento di un contatore scritto da un solo thread (niente RMW atomico)
+template <class T>
+inline void Bump(std::atomic<T>& counter) {
+    counter.store(counter.load(memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+}
+
+AsyncTelemetrySink::AsyncTelemetrySink(TelemetrySink& inner, size_t queue_capacity,
+                                       BackPressure policy, uint32_t sample_every)
+    : m_inner(inner),
+      m_ring(queue_capacity),
+      m_policy(policy),
+      m_sample_every(sample_every > 0 ? sample_every : 1),
+      m_sample_counter(0),
+      m_running(true),
+      m_flush_requested(0),
+      m_flush_done(0),
+      m_enqueued(0),
+      m_dropped(0),
+      m_sampled_out(0),
+      m_max_depth(0),
+      m_written(0)
+{
+    m_writer = thread(&AsyncTelemetrySink::WriterLoop, this);
+}
+
+AsyncTelemetrySink::~AsyncTelemetrySink() {
+    Close();
+}
+
+bool AsyncTelemetrySink::ParsePolicy(const string& name, BackPressure& policy) {
+    if (name == "block") policy = BLOCK;
+    else if (name == "drop") policy = DROP;
+    else if (name == "sample") policy = SAMPLE;
+    else return false;
+    return true;
+}
+
+void AsyncTelemetrySink::Write(const ObservationRecord& rec) {
+    size_t depth = m_ring.Size();
+    if (depth > m_max_depth.load(memory_order_relaxed)) m_max_depth.store(depth, memory_order_relaxed);
+
+    if (m_policy == SAMPLE && depth >= m_ring.Capacity() / 2) {
+        if (m_sample_counter++ % m_sample_every != 0) {
+            Bump(m_sampled_out);
+            return;
+        }
+    }
+
+    while (!m_ring.TryPush(rec)) {
+        if (m_policy != BLOCK) {
+            Bump(m_dropped);
+            return;
+        }
+        this_thread::yield();
+    }
+    Bump(m_enqueued);
+}
+
+void AsyncTelemetrySink::Flush() {
+    if (!m_writer.joinable()) return;
+    uint64_t request = m_flush_requested.load(memory_order_relaxed) + 1;
+    m_flush_requested.store(request, memory_order_release);
+    while (m_flush_done.load(memory_order_acquire) < request) this_thread::yield();
+}
+
+void AsyncTelemetrySink::Close() {
+    if (!m_writer.joinable()) return;
+    m_running.store(false, memory_order_release);
+    m_writer.join();
+}
+
+void AsyncTelemetrySink::WriterLoop() {
+    vector<ObservationRecord> batch(WRITER_BATCH);
+    unsigned idle = 0;
+
+    while (true) {
+        size_t n = m_ring.PopBatch(batch.data(), batch.size());
+        if (n > 0) {
+            for (size_t i = 0; i < n; ++i) m_inner.Write(batch[i]);
+            m_written.store(m_written.load(memory_order_relaxed) + n, memory_order_relaxed);
+            idle = 0;
+            continue;
+        }
+
+        uint64_t request = m_flush_requested.load(memory_order_acquire);
+        if (request != m_flush_done.load(memory_order_relaxed)) {
+            // Il ring puo' essersi riempito tra il PopBatch vuoto e la lettura della richiesta:
+            // quei record sono stati scritti prima del Flush() e devono precederne il completamento
+            if (m_ring.Size() != 0) continue;
+            m_inner.Flush();
+            m_flush_done.store(request, memory_order_release);
+            continue;
+        }
+
+        if (!m_running.load(memory_order_acquire)) {
+            // Il produttore ha finito: un ultimo giro per i record arrivati nel frattempo
+            if (m_ring.Size() == 0) break;
+            continue;
+        }
+
+        if (++idle < SPIN_BEFORE_SLEEP) this_thread::yield();
+        else this_thread::sleep_for(chrono::microseconds(200));
+    }
+    m_inner.Flush();
+}
+
+AsyncTelemetrySink::Stats AsyncTelemetrySink::GetStats() const {
+    Stats s;
+    s.enqueued = m_enqueued.load(memory_order_relaxed);
+    s.written = m_written.load(memory_order_relaxed);
+    s.dropped = m_dropped.load(memory_order_relaxed);
+    s.sampled_out = m_sampled_out.load(memory_order_relaxed);
+    s.queue_depth = m_ring.Size();
+    s.max_queue_depth = m_max_depth.load(memory_order_relaxed);
+    s.queue_capacity = m_ring.Capacity();
+    return s;
+}
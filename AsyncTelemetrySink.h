@@ -0,0 +1,70 @@
+#ifndef ASYNC_TELEMETRY_SINK_H
+#define ASYNC_TELEMETRY_SINK_H
+
+#include "TelemetryWriter.h"
+#include "SpscRing.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+/**
+ * Sink asincrono: il loop degli slot copia i record in un ring buffer SPSC limitato e
+ * un thread di scrittura li preleva a lotti e li passa al sink reale (CSV o colonnare).
+ * Il thread dello slot non tocca mai il disco.
+ *
+ * Quando la coda e' piena la politica di back-pressure decide cosa fare:
+ *   BLOCK   il produttore aspetta che si liberi spazio (nessuna perdita)
+ *   DROP    il record viene scartato
+ *   SAMPLE  oltre meta' coda si tiene solo un record ogni sample_every, a coda piena si scarta
+ */
+class AsyncTelemetrySink : public TelemetrySink {
+public:
+    enum BackPressure { BLOCK, DROP, SAMPLE };
+
+    struct Stats {
+        uint64_t enqueued;
+        uint64_t written;
+        uint64_t dropped;
+        uint64_t sampled_out;
+        size_t queue_depth;
+        size_t max_queue_depth;
+        size_t queue_capacity;   // capacita' effettiva del ring (potenza di 2 >= quella richiesta)
+    };
+
+    AsyncTelemetrySink(TelemetrySink& inner, size_t queue_capacity = 65536,
+                       BackPressure policy = BLOCK, uint32_t sample_every = 10);
+    ~AsyncTelemetrySink() override;
+
+    void Write(const ObservationRecord& rec) override;
+    void Flush() override;   // attende lo svuotamento della coda e il flush del sink reale
+    void Close();            // svuota la coda e ferma il thread di scrittura
+
+    Stats GetStats() const;
+    static bool ParsePolicy(const std::string& name, BackPressure& policy);
+
+private:
+    void WriterLoop();
+
+    TelemetrySink& m_inner;
+    SpscRing<ObservationRecord> m_ring;
+    BackPressure m_policy;
+    uint32_t m_sample_every;
+    uint64_t m_sample_counter;
+
+    std::atomic<bool> m_running;
+    std::atomic<uint64_t> m_flush_requested;
+    std::atomic<uint64_t> m_flush_done;
+
+    // Contatori del produttore (scritti solo dal thread dello slot)
+    std::atomic<uint64_t> m_enqueued;
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<uint64_t> m_sampled_out;
+    std::atomic<size_t> m_max_depth;
+    // Contatore del consumatore
+    std::atomic<uint64_t> m_written;
+
+    std::thread m_writer;
+};
+
+#endif
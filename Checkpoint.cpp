@@ -0,0 +1,79 @@
+#include "Checkpoint.h"
+#include <fstream>
+
+using namespace std;
+
+void CheckpointWriter::PutBytes(const void* p, size_t n) {
+    const char* c = static_cast<const char*>(p);
+    m_buf.insert(m_buf.end(), c, c + n);
+}
+
+void CheckpointWriter::PutString(const string& s) {
+    Put<uint32_t>((uint32_t)s.size());
+    PutBytes(s.data(), s.size());
+}
+
+void CheckpointWriter::PutEngine(const mt19937& engine) {
+    ostringstream os;
+    os << engine;
+    istringstream is(os.str());
+    vector<uint32_t> words;
+    uint32_t w;
+    while (is >> w) words.push_back(w);
+    PutVector(words);
+}
+
+bool CheckpointWriter::WriteFile(const string& path) const {
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out.is_open()) return false;
+    out.write(m_buf.data(), m_buf.size());
+    return (bool)out;
+}
+
+bool CheckpointReader::ReadFile(const string& path) {
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in.is_open()) return false;
+    m_buf.resize((size_t)in.tellg());
+    in.seekg(0);
+    in.read(m_buf.data(), m_buf.size());
+    m_pos = 0;
+    m_ok = (bool)in;
+    return m_ok;
+}
+
+void CheckpointReader::GetBytes(void* p, size_t n) {
+    if (!m_ok || n > m_buf.size() - m_pos) {
+        m_ok = false;
+        memset(p, 0, n);
+        return;
+    }
+    memcpy(p, m_buf.data() + m_pos, n);
+    m_pos += n;
+}
+
+Eigen::Vector3d CheckpointReader::GetVector3() {
+    Eigen::Vector3d v;
+    GetBytes(v.data(), 3 * sizeof(double));
+    return v;
+}
+
+string CheckpointReader::GetString() {
+    uint32_t n = Get<uint32_t>();
+    if (!m_ok || n > m_buf.size() - m_pos) {
+        m_ok = false;
+        return string();
+    }
+    string s(m_buf.data() + m_pos, n);
+    m_pos += n;
+    return s;
+}
+
+void CheckpointReader::GetEngine(mt19937& engine) {
+    vector<uint32_t> words;
+    GetVector(words);
+    if (!m_ok) return;
+    ostringstream os;
+    for (size_t i = 0; i < words.size(); ++i) os << (i ? " " : "") << words[i];
+    istringstream is(os.str());
+    if (!(is >> engine)) m_ok = false;
+}
@@ -0,0 +1,96 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Snapshot binario dello stato di una run (vedi SwarmSimulation::SaveCheckpoint).
+ *
+ * Il blob si costruisce in memoria e si scrive con una sola write; i vettori (banca EKF
+ * compresa) sono copiati in blocco, quindi salvataggio e caricamento costano quanto una
+ * memcpy della banca. Ogni classe scrive e rilegge i propri campi nello stesso ordine in
+ * SaveState/LoadState; il lettore segnala un blob troncato invece di leggere oltre la fine.
+ */
+class CheckpointWriter {
+public:
+    template <class T>
+    void Put(const T& value) { PutBytes(&value, sizeof(T)); }
+
+    template <class T>
+    void PutVector(const std::vector<T>& v) {
+        Put<uint64_t>(v.size());
+        PutBytes(v.data(), v.size() * sizeof(T));
+    }
+
+    void PutVector3(const Eigen::Vector3d& v) { PutBytes(v.data(), 3 * sizeof(double)); }
+    void PutString(const std::string& s);
+
+    // Motori e distribuzioni della libreria standard tramite il loro formato testuale
+    // (per mt19937: 625 interi, salvati in binario)
+    void PutEngine(const std::mt19937& engine);
+    template <class D>
+    void PutDistribution(const D& dist) {
+        std::ostringstream os;
+        os.precision(17);
+        os << dist;
+        PutString(os.str());
+    }
+
+    const std::vector<char>& Data() const { return m_buf; }
+    bool WriteFile(const std::string& path) const;
+
+private:
+    void PutBytes(const void* p, size_t n);
+    std::vector<char> m_buf;
+};
+
+class CheckpointReader {
+public:
+    CheckpointReader() : m_pos(0), m_ok(true) {}
+
+    bool ReadFile(const std::string& path);
+    bool Ok() const { return m_ok; }
+    bool AtEnd() const { return m_pos == m_buf.size(); }
+
+    template <class T>
+    T Get() {
+        T value{};
+        GetBytes(&value, sizeof(T));
+        return value;
+    }
+
+    // Con expected_size >= 0 un vettore di lunghezza diversa rende il blob non valido
+    template <class T>
+    void GetVector(std::vector<T>& v, int64_t expected_size = -1) {
+        uint64_t n = Get<uint64_t>();
+        if (!m_ok || (expected_size >= 0 && n != (uint64_t)expected_size) || n * sizeof(T) > m_buf.size() - m_pos) {
+            m_ok = false;
+            return;
+        }
+        v.resize(n);
+        GetBytes(v.data(), n * sizeof(T));
+    }
+
+    Eigen::Vector3d GetVector3();
+    std::string GetString();
+    void GetEngine(std::mt19937& engine);
+    template <class D>
+    void GetDistribution(D& dist) {
+        std::istringstream is(GetString());
+        if (m_ok && !(is >> dist)) m_ok = false;
+    }
+
+private:
+    void GetBytes(void* p, size_t n);
+    std::vector<char> m_buf;
+    size_t m_pos;
+    bool m_ok;
+};
+
+#endif
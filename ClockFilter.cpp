@@ -0,0 +1,97 @@
+#include "ClockFilter.h"
+#include <limits>
+
+ClockFilter::ClockFilter()
+    : m_initialized(false), m_time(0.0), m_offset(0.0), m_skew(0.0), m_p00(0.0), m_p01(0.0), m_p11(0.0), m_rejects(0) {}
+
+bool ClockFilter::IsLocked(double t) const {
+    return m_initialized && m_p11 < LOCK_SKEW_SIGMA * LOCK_SKEW_SIGMA
+        && OffsetVariance(t) < LOCK_OFFSET_SIGMA * LOCK_OFFSET_SIGMA;
+}
+
+double ClockFilter::Offset(double t) const {
+    return m_initialized ? m_offset + m_skew * (t - m_time) : 0.0;
+}
+
+double ClockFilter::OffsetVariance(double t) const {
+    if (!m_initialized) return std::numeric_limits<double>::infinity();
+    double dt = t - m_time;
+    return m_p00 + 2.0 * dt * m_p01 + dt * dt * m_p11 + PHASE_NOISE * dt + FREQUENCY_NOISE * dt * dt * dt / 3.0;
+}
+
+// F = [1 dt; 0 1], Q = [q1 dt + q2 dt^3/3, q2 dt^2/2; q2 dt^2/2, q2 dt]
+void ClockFilter::Predict(double t) {
+    double dt = t - m_time;
+    if (dt <= 0.0) return;
+    m_offset += m_skew * dt;
+    double p00 = m_p00 + 2.0 * dt * m_p01 + dt * dt * m_p11;
+    double p01 = m_p01 + dt * m_p11;
+    m_p00 = p00 + PHASE_NOISE * dt + FREQUENCY_NOISE * dt * dt * dt / 3.0;
+    m_p01 = p01 + FREQUENCY_NOISE * dt * dt / 2.0;
+    m_p11 += FREQUENCY_NOISE * dt;
+    m_time = t;
+}
+
+bool ClockFilter::Update(double t, double observed_offset, double variance, bool reference) {
+    if (!m_initialized) {
+        m_initialized = true;
+        m_time = t;
+        m_offset = observed_offset;
+        m_skew = 0.0;
+        m_p00 = variance;
+        m_p01 = 0.0;
+        m_p11 = INITIAL_SKEW_SIGMA * INITIAL_SKEW_SIGMA;
+        m_rejects = 0;
+        return true;
+    }
+
+    Predict(t);
+    if (m_rejects >= MAX_REJECTS) {
+        // Fuori aggancio: si riparte dall'offset osservato, lo skew resta
+        m_offset = observed_offset;
+        m_p00 = variance;
+        m_p01 = 0.0;
+        m_rejects = 0;
+        return true;
+    }
+    // H = [1 0]
+    double y = observed_offset - m_offset;
+    double s = m_p00 + variance;
+    if (!reference && y * y > GATE_SIGMA * GATE_SIGMA * s) {
+        m_rejects++;
+        return false;
+    }
+    m_rejects = 0;
+    double k0 = m_p00 / s, k1 = m_p01 / s;
+    m_offset += k0 * y;
+    m_skew += k1 * y;
+    double p00 = (1.0 - k0) * m_p00;
+    double p01 = (1.0 - k0) * m_p01;
+    double p11 = m_p11 - k1 * m_p01;
+    m_p00 = p00;
+    m_p01 = p01;
+    m_p11 = p11;
+    return true;
+}
+
+void ClockFilter::SaveState(CheckpointWriter& out) const {
+    out.Put<uint8_t>(m_initialized ? 1 : 0);
+    out.Put<double>(m_time);
+    out.Put<double>(m_offset);
+    out.Put<double>(m_skew);
+    out.Put<double>(m_p00);
+    out.Put<double>(m_p01);
+    out.Put<double>(m_p11);
+    out.Put<int32_t>(m_rejects);
+}
+
+void ClockFilter::LoadState(CheckpointReader& in) {
+    m_initialized = in.Get<uint8_t>() != 0;
+    m_time = in.Get<double>();
+    m_offset = in.Get<double>();
+    m_skew = in.Get<double>();
+    m_p00 = in.Get<double>();
+    m_p01 = in.Get<double>();
+    m_p11 = in.Get<double>();
+    m_rejects = in.Get<int32_t>();
+}
@@ -0,0 +1,62 @@
+#ifndef CLOCK_FILTER_H
+#define CLOCK_FILTER_H
+
+#include "Checkpoint.h"
+
+/**
+ * Filtro di Kalman a due stati sull'errore del clock di un drone rispetto al tempo del
+ * Master Anchor: offset theta (s) e skew gamma (s/s), theta(t) = theta(t0) + gamma (t - t0).
+ *
+ * Ogni messaggio ricevuto in LOS e' un'osservazione dell'offset: arrivo misurato meno
+ * timestamp del trasmettitore (gia' corretto con la sua stima) meno il tempo di volo
+ * atteso dalle posizioni. La varianza dell'osservazione comprende quella della stima del
+ * trasmettitore, quindi i messaggi del Master Anchor (riferimento, varianza nulla) pesano
+ * di piu' ma non sono gli unici: la sincronizzazione non richiede slot dedicati.
+ *
+ * Modello di processo: rumore bianco di fase e random walk di frequenza (matrice Q classica
+ * dei clock a due stati). Le innovazioni oltre GATE_SIGMA deviazioni standard vengono
+ * scartate, tranne quelle del riferimento: le stime dei vicini sono correlate e, senza il
+ * Master a tenerle, lo sciame potrebbe derivare in blocco. Dopo MAX_REJECTS scarti
+ * consecutivi il filtro si considera fuori aggancio e l'offset riparte dall'osservazione
+ * corrente; lo skew, proprieta' fisica dell'oscillatore, resta.
+ *
+ * Il filtro e' agganciato quando sia l'offset sia lo skew sono noti entro LOCK_OFFSET_SIGMA e
+ * LOCK_SKEW_SIGMA: solo allora il drone misura ToA e fa da riferimento ai vicini.
+ */
+class ClockFilter {
+public:
+    ClockFilter();
+
+    bool IsInitialized() const { return m_initialized; }
+    bool IsLocked(double t) const;
+    // Offset predetto all'istante t e sua varianza (0 e infinito finche' non e' inizializzato)
+    double Offset(double t) const;
+    double OffsetVariance(double t) const;
+    double Skew() const { return m_skew; }
+
+    // Osservazione dell'offset all'istante t con varianza variance; false se scartata dal gate.
+    // Le osservazioni del riferimento (reference) non passano dal gate
+    bool Update(double t, double observed_offset, double variance, bool reference);
+
+    void SaveState(CheckpointWriter& out) const;
+    void LoadState(CheckpointReader& in);
+
+private:
+    static constexpr double PHASE_NOISE = 1e-20;      // s^2/s
+    static constexpr double FREQUENCY_NOISE = 1e-18;  // (s/s)^2/s
+    static constexpr double INITIAL_SKEW_SIGMA = 50e-6;
+    static constexpr double GATE_SIGMA = 5.0;
+    static const int MAX_REJECTS = 10;
+    static constexpr double LOCK_OFFSET_SIGMA = 3e-9;  // ~1 m
+    static constexpr double LOCK_SKEW_SIGMA = 1e-7;
+
+    void Predict(double t);
+
+    bool m_initialized;
+    double m_time;
+    double m_offset, m_skew;
+    double m_p00, m_p01, m_p11;
+    int m_rejects;
+};
+
+#endif
@@ -2,54 +2,48 @@
 #include <iostream>
 #include <cmath>
 #include <algorithm>
+#include <limits>
 
-using namespace ns3;
 using namespace Eigen;
 using namespace std;
 
-TypeId Drone::GetTypeId() {
-    static TypeId tid = TypeId("Drone")
-        .SetParent<Object>()
-        .SetGroupName("UWB-Localization");
-    return tid;
-}
-
 void Drone::ResetState(Vector3d recovered_pos) {
 	const double alpha = 0.15; 
-	m_true_position = (1.0 - alpha) * m_true_position + alpha * recovered_pos;
-    double dist = (m_true_position - recovered_pos).norm();
+	Vector3d blended = (1.0 - alpha) * GetTruePosition() + alpha * recovered_pos;
+    if (m_kinematics) m_kinematics->SetPosition(m_id, blended);
+    else m_true_position = blended;
+    double dist = (blended - recovered_pos).norm();
     if (dist < 1.0) {
-            for (auto& pair : m_security_alarm) pair.second = false;
+            m_filter_bank->ClearAlarmsOf(m_id);
         }
 }
 
-uint32_t Drone::GetVoteBitmask() {
-    uint32_t mask = 0xFFFFFFFF; 
-    for (auto const& [id, is_alarm] : m_security_alarm) {
-        if (is_alarm) mask &= ~(1 << id);
-    }
-    return mask;
+void Drone::GetVotes(VoteBitset& out) const {
+    m_filter_bank->GetConsensus().GetVotes(m_id, out);
 }
 
 UWBMessage Drone::CreateTDMAMessage() {
     UWBMessage msg;
+    CreateTDMAMessage(msg);
+    return msg;
+}
+
+void Drone::CreateTDMAMessage(UWBMessage& msg) {
     msg.sender_id = m_id;
     msg.gps_position = GetGPSPosition();
-    uint32_t mask = 0xFFFFFFFF; 
-    for (auto const& [target_id, is_alarmed] : m_security_alarm) {
-        if (is_alarmed) {
-            mask &= ~(1 << target_id); 
-        }
-    }
-    msg.vote_bitmask = mask;
+    GetVotes(msg.votes);
 
     uint64_t drift_ps = (uint64_t)(m_clock_drift_ns * 1000.0);
-    msg.tx_timestamp_ps = Simulator::Now().GetPicoSeconds() + drift_ps; 
-    
-    return msg;
+    uint64_t now_ps = m_clock ? m_clock->NowPicoSeconds() : 0;
+    uint64_t skew_ps = (uint64_t)std::llround(m_clock_skew * (double)now_ps);
+    msg.tx_timestamp_ps = now_ps + drift_ps + skew_ps;
+    // Finche' il clock non e' agganciato il messaggio non fa da riferimento ai vicini
+    double now = Now();
+    msg.clock_offset = m_clock_filter.Offset(now);
+    msg.clock_offset_var = m_clock_filter.IsLocked(now) ? m_clock_filter.OffsetVariance(now) : std::numeric_limits<double>::infinity();
 }
 
-Drone::Drone() : m_id(0), m_is_malicious(false), m_clock_drift_ns(0.0), m_clock_offset_correction(0.0), m_attack_start_time(0.0) {
+Drone::Drone() : m_id(0), m_is_malicious(false), m_clock_drift_ns(0.0), m_clock_offset_correction(0.0), m_clock_skew(0.0), m_attack_start_time(0.0), m_filter_bank(nullptr), m_kinematics(nullptr), m_clock(nullptr) {
     std::random_device rd;
     m_rng.seed(rd());
     m_gps_noise_horiz = std::normal_distribution<double>(0.0, 0.05); 
@@ -60,43 +54,54 @@ Drone::~Drone() {}
 
 void Drone::SetId(uint32_t id) { m_id = id; }
 uint32_t Drone::GetId() const { return m_id; }
+void Drone::SetFilterBank(SwarmFilterBank* bank) { m_filter_bank = bank; }
+void Drone::SetKinematics(KinematicsEngine* kinematics) { m_kinematics = kinematics; }
+void Drone::SetClock(const SimClock* clock) { m_clock = clock; }
+void Drone::SetSeed(uint32_t seed) { m_rng.seed(seed); }
 
 void Drone::SetMalicious(bool is_malicious) 
 { 
 	if (is_malicious && !m_is_malicious) 
 	{
-        m_attack_start_time = Simulator::Now().GetSeconds();
+        m_attack_start_time = Now();
     }
 	m_is_malicious = is_malicious; 
 }
-void Drone::SetInitialPosition(Vector3d pos) { m_true_position = pos; }
-void Drone::SetTrajectory(std::function<Vector3d(double)> traj_func) { m_trajectory = traj_func; }
+void Drone::SetInitialPosition(Vector3d pos) {
+    if (m_kinematics) m_kinematics->SetPosition(m_id, pos);
+    else m_true_position = pos;
+}
+void Drone::SetTrajectory(std::function<Vector3d(double)> traj_func) {
+    if (m_kinematics) m_kinematics->SetTrajectory(m_id, traj_func);
+    else m_trajectory = traj_func;
+}
 bool Drone::IsMalicious() { return m_is_malicious; }
 
 Vector3d Drone::GetRecoveredPosition(int target_id, const std::map<int, Vector3d>& all_peer_estimates) {
-    std::vector<double> x_coords, y_coords, z_coords;
-
-    for (auto const& [peer_id, estimate] : all_peer_estimates) {
-        x_coords.push_back(estimate.x());
-        y_coords.push_back(estimate.y());
-        z_coords.push_back(estimate.z());
-    }
+    std::vector<Vector3d> estimates;
+    for (auto const& [peer_id, estimate] : all_peer_estimates) estimates.push_back(estimate);
+    return GetRecoveredPosition(estimates.data(), (int)estimates.size());
+}
 
-    if (x_coords.empty()) return Vector3d(0,0,0);
+Vector3d Drone::GetRecoveredPosition(const Vector3d* peer_estimates, int count) {
+    if (count == 0) return Vector3d(0,0,0);
 
-    auto findMedian = [](std::vector<double>& v) {
-        size_t n = v.size() / 2;
-        std::nth_element(v.begin(), v.begin() + n, v.end());
-        return v[n];
+    // Una coordinata alla volta nello stesso buffer: nth_element da' lo stesso valore in qualunque ordine
+    m_median_scratch.resize(count);
+    auto findMedian = [&](int axis) {
+        for (int i = 0; i < count; ++i) m_median_scratch[i] = peer_estimates[i](axis);
+        size_t n = count / 2;
+        std::nth_element(m_median_scratch.begin(), m_median_scratch.begin() + n, m_median_scratch.end());
+        return m_median_scratch[n];
     };
-     
-    return Vector3d(
-        findMedian(x_coords),
-        findMedian(y_coords),
-        findMedian(z_coords)
-    );
+
+    double x = findMedian(0);
+    double y = findMedian(1);
+    double z = findMedian(2);
+    return Vector3d(x, y, z);
 }
 
+// Solo senza motore cinematico: con il motore la posizione si ricava al tempo corrente
 void Drone::UpdatePosition(double time) {
     if (m_trajectory) m_true_position = m_trajectory(time);
 }
@@ -110,12 +115,12 @@ Vector3d Drone::AddGPSNoise(Vector3d true_pos) {
 }
 
 Vector3d Drone::GetGPSPosition() {
-    Vector3d noisy = AddGPSNoise(m_true_position);
+    Vector3d noisy = AddGPSNoise(GetTruePosition());
     if (m_is_malicious) {
         const double TARGET_OFFSET = 15.0; 
         const double RAMP_DURATION = 10.0; 
 
-        double now = Simulator::Now().GetSeconds();
+        double now = Now();
         double time_elapsed = now - m_attack_start_time;
         double progress = time_elapsed / RAMP_DURATION;
         if (progress < 0.0) progress = 0.0;
@@ -125,7 +130,9 @@ Vector3d Drone::GetGPSPosition() {
     return noisy;
 }
 
-Vector3d Drone::GetTruePosition() const { return m_true_position; }
+Vector3d Drone::GetTruePosition() const {
+    return m_kinematics ? m_kinematics->GetPosition(m_id) : m_true_position;
+}
 
 void Drone::SetClockDrift(double drift_ns) { m_clock_drift_ns = drift_ns; }
 double Drone::GetClockDrift() const { return m_clock_drift_ns; }
@@ -133,51 +140,59 @@ double Drone::GetClockDrift() const { return m_clock_drift_ns; }
 void Drone::SetClockOffset(double offset) { m_clock_offset_correction = offset; }
 double Drone::GetClockOffset() const { return m_clock_offset_correction; }
 
+void Drone::SetClockSkew(double skew) { m_clock_skew = skew; }
+
 void Drone::ComputeNeighborPosition(int sender_id, Vector3d claimed_gps, const vector<RangingMeasurement>& measurements,
     								double current_time, double tx_timestamp_sec) 
 {
     if ((int)m_id == sender_id) return;
 
-    if (m_my_ekf_bank.find(sender_id) == m_my_ekf_bank.end()) 
-    {
-        m_my_ekf_bank[sender_id].Init(claimed_gps); 
-        m_last_calc_time[sender_id] = 0.0;
-        m_security_alarm[sender_id] = false;
-    }
-    
-    if(measurements.size() < 4) return;
-
-    vector<TDoAEKF::Msmnt> input_data;
-    for(const auto& m : measurements) {
-        TDoAEKF::Msmnt data;
-        data.anchor_pos = m.anchor_pos; 
-        data.toa = m.toa_seconds;       
-        data.tx_timestamp = tx_timestamp_sec; 
-        
-        input_data.push_back(data);
-    }
-
-    double dt = current_time - m_last_calc_time[sender_id];
-    if (dt > 0) 
-    {
-        m_my_ekf_bank[sender_id].Predict(dt);
-        m_my_ekf_bank[sender_id].Update(input_data);
-        m_last_calc_time[sender_id] = current_time;
-    }
-
-    Vector3d calculated_pos = m_my_ekf_bank[sender_id].GetPosition();
-    double error = (calculated_pos - claimed_gps).norm();
-    
-    if (error > 10.0) m_security_alarm[sender_id] = true;
-    else m_security_alarm[sender_id] = false;
+    SwarmFilterBank::TransmitterBatch batch;
+    batch.target = sender_id;
+    batch.claimed_gps = claimed_gps;
+    batch.measurements = measurements.data();
+    batch.num_measurements = (int)measurements.size();
+    batch.keep = nullptr;
+    batch.keep_stride = 0;
+    batch.current_time = current_time;
+    batch.tx_timestamp = tx_timestamp_sec;
+
+    m_filter_bank->ProcessTransmitter(batch, m_id, m_id + 1);
 }
 
 Vector3d Drone::GetEstimatedPositionOf(int target_id) {
-    if (m_my_ekf_bank.count(target_id)) return m_my_ekf_bank[target_id].GetPosition();
-    return Vector3d(0,0,0);
+    return m_filter_bank->GetPosition(m_id, target_id);
 }
 
 bool Drone::IsAlarmActiveFor(int target_id) {
-    if (m_security_alarm.count(target_id)) return m_security_alarm[target_id];
-    return false;
-}
\ No newline at end of file
+    return m_filter_bank->IsAlarmActive(m_id, target_id);
+}
+
+void Drone::SaveState(CheckpointWriter& out) const {
+    out.Put<uint32_t>(m_id);
+    out.Put<uint8_t>(m_is_malicious ? 1 : 0);
+    out.Put<double>(m_clock_drift_ns);
+    out.Put<double>(m_clock_offset_correction);
+    out.Put<double>(m_clock_skew);
+    m_clock_filter.SaveState(out);
+    out.Put<double>(m_attack_start_time);
+    out.PutVector3(m_true_position);
+    out.PutEngine(m_rng);
+    out.PutDistribution(m_gps_noise_horiz);
+    out.PutDistribution(m_gps_noise_vert);
+}
+
+bool Drone::LoadState(CheckpointReader& in) {
+    if (in.Get<uint32_t>() != m_id) return false;
+    m_is_malicious = in.Get<uint8_t>() != 0;
+    m_clock_drift_ns = in.Get<double>();
+    m_clock_offset_correction = in.Get<double>();
+    m_clock_skew = in.Get<double>();
+    m_clock_filter.LoadState(in);
+    m_attack_start_time = in.Get<double>();
+    m_true_position = in.GetVector3();
+    in.GetEngine(m_rng);
+    in.GetDistribution(m_gps_noise_horiz);
+    in.GetDistribution(m_gps_noise_vert);
+    return in.Ok();
+}
@@ -1,36 +1,44 @@
 #ifndef DRONE_H
 #define DRONE_H
 
-#include "ns3/core-module.h"
 #include <Eigen/Dense>
 #include <vector>
 #include <functional>
 #include <map>
-#include "TDoAEKF.h"
+#include "SwarmFilterBank.h"
+#include "KinematicsEngine.h"
 #include "UWBMessage.h"
+#include "SimClock.h"
+#include "ClockFilter.h"
 #include <random>
-using namespace ns3;
 using namespace Eigen;
 using namespace std;
 
 typedef std::function<Vector3d(double)> TrajectoryFunc;
 
-class Drone : public Object {
+class Drone {
 public:
 	void ResetState(Vector3d corrected_pos);
     Vector3d GetRecoveredPosition(int target_id, const std::map<int, 
                                   Vector3d>& all_peer_estimates);
-    uint32_t GetVoteBitmask();
+    // Mediana per coordinata di count stime; usa un buffer interno riutilizzato, nessuna allocazione a regime
+    Vector3d GetRecoveredPosition(const Vector3d* peer_estimates, int count);
+    void GetVotes(VoteBitset& out) const;
 
-    static TypeId GetTypeId();
     Drone();
     virtual ~Drone();
 
     void SetId(uint32_t id);
     uint32_t GetId() const;
+    void SetFilterBank(SwarmFilterBank* bank);
+    // Con un motore cinematico traiettoria e posizione vera vivono li' (voce m_id)
+    void SetKinematics(KinematicsEngine* kinematics);
+    void SetClock(const SimClock* clock);
+    void SetSeed(uint32_t seed);
 
     void SetMalicious(bool is_malicious);
     bool IsMalicious();
+    double GetAttackStartTime() const { return m_attack_start_time; }
     
     void SetInitialPosition(Vector3d pos);
     void SetTrajectory(TrajectoryFunc traj_func);
@@ -43,17 +51,32 @@ public:
     double GetClockDrift() const;
     void SetClockOffset(double offset);
     double GetClockOffset() const;
+    // Skew fisico del clock (s/s): l'errore vero del clock all'istante t e' drift + skew * t
+    void SetClockSkew(double skew);
+    double GetClockSkew() const { return m_clock_skew; }
+    double GetClockError(double t) const { return m_clock_drift_ns * 1e-9 + m_clock_skew * t; }
+    // Stima di offset e skew rispetto al Master Anchor (clock_sync = filter)
+    ClockFilter& GetClockFilter() { return m_clock_filter; }
+    const ClockFilter& GetClockFilter() const { return m_clock_filter; }
     UWBMessage CreateTDMAMessage();    
+    // Riempie msg riusandone la bitmask dei voti (nessuna allocazione se la dimensione non cambia)
+    void CreateTDMAMessage(UWBMessage& msg);
     void ComputeNeighborPosition(int sender_id, Vector3d claimed_gps, const vector<RangingMeasurement>& measurements, 
                                  double current_time, double tx_timestamp_sec);
     Vector3d GetEstimatedPositionOf(int target_id);
     bool IsAlarmActiveFor(int target_id);
 
+    // Stato proprio del drone (attacco, clock, generatore del rumore GPS); i filtri sono nella banca
+    void SaveState(CheckpointWriter& out) const;
+    bool LoadState(CheckpointReader& in);
+
 private:
     uint32_t m_id;
     bool m_is_malicious;
     double m_clock_drift_ns;
     double m_clock_offset_correction;
+    double m_clock_skew;
+    ClockFilter m_clock_filter;
     double m_attack_start_time;
     
     Vector3d m_true_position;
@@ -64,10 +87,13 @@ private:
     std::normal_distribution<double> m_gps_noise_vert;
 
     Vector3d AddGPSNoise(Vector3d true_pos);
+    vector<double> m_median_scratch;
 
-    std::map<int, TDoAEKF> m_my_ekf_bank;
-    std::map<int, double> m_last_calc_time;
-    std::map<int, bool> m_security_alarm;
+    // I filtri (e gli allarmi) di questo drone sono la riga m_id della banca dello sciame
+    SwarmFilterBank* m_filter_bank;
+    KinematicsEngine* m_kinematics;
+    const SimClock* m_clock;
+    double Now() const { return m_clock ? m_clock->Now() : 0.0; }
 };
 
 #endif
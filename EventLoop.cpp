@@ -0,0 +1,27 @@
+#include "EventLoop.h"
+
+EventLoop::EventLoop() : m_now_ps(0), m_seq(0) {}
+
+void EventLoop::Schedule(double delay_s, std::function<void()> fn) {
+    m_queue.push(Event{m_now_ps + ToPicoSeconds(delay_s), m_seq++, std::move(fn)});
+}
+
+void EventLoop::Reset(int64_t now_ps) {
+    m_queue = decltype(m_queue)();
+    m_now_ps = now_ps;
+}
+
+void EventLoop::Run(double stop_time_s) {
+    const int64_t stop_ps = ToPicoSeconds(stop_time_s);
+    const uint64_t stop_seq = m_seq++;
+
+    while (!m_queue.empty()) {
+        const Event& top = m_queue.top();
+        if (top.time_ps > stop_ps || (top.time_ps == stop_ps && top.seq > stop_seq)) break;
+        std::function<void()> fn = std::move(const_cast<Event&>(top).fn);
+        m_now_ps = top.time_ps;
+        m_queue.pop();
+        fn();
+    }
+    m_now_ps = stop_ps;
+}
@@ -0,0 +1,42 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include "SimClock.h"
+#include <queue>
+#include <vector>
+
+/**
+ * Simulatore a eventi discreti minimale: coda di priorita' su (istante, ordine di inserimento).
+ * Nessuno stato globale, quindi piu' run possono girare nello stesso processo.
+ * Run lascia in coda gli eventi successivi allo stop: una nuova Run riprende da li'.
+ */
+class EventLoop : public SimClock {
+public:
+    EventLoop();
+
+    int64_t NowPicoSeconds() const override { return m_now_ps; }
+    void Schedule(double delay_s, std::function<void()> fn) override;
+    void Run(double stop_time_s) override;
+
+    size_t GetPendingEvents() const { return m_queue.size(); }
+    // Svuota la coda e porta l'orologio a now_ps (ripristino da checkpoint)
+    void Reset(int64_t now_ps);
+
+private:
+    struct Event {
+        int64_t time_ps;
+        uint64_t seq;
+        std::function<void()> fn;
+    };
+    struct Later {
+        bool operator()(const Event& a, const Event& b) const {
+            return a.time_ps != b.time_ps ? a.time_ps > b.time_ps : a.seq > b.seq;
+        }
+    };
+
+    std::priority_queue<Event, std::vector<Event>, Later> m_queue;
+    int64_t m_now_ps;
+    uint64_t m_seq;
+};
+
+#endif
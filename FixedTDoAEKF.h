@@ -0,0 +1,131 @@
+#ifndef FIXED_TDOA_EKF_H
+#define FIXED_TDOA_EKF_H
+
+#include <Eigen/Dense>
+#include <vector>
+#include "TDoAEKF.h"
+
+using namespace Eigen;
+using namespace std;
+
+/**
+ * Versione a dimensione fissa di TDoAEKF: stato [x y z vx vy vz bias] a 7 componenti
+ * e al massimo MaxAnchors misure per Update. Tutte le matrici vivono sullo stack,
+ * quindi Predict e Update non allocano mai memoria dinamica.
+ *
+ * Predict sfrutta la struttura a blocchi della F a velocita' costante (solo i blocchi
+ * pos/vel cambiano), Update usa il fatto che H ha colonne non nulle solo su posizione
+ * e bias e risolve S con una fattorizzazione di Cholesky invece di invertirla.
+ * Update con piu' di MaxAnchors misure non tocca il filtro e restituisce false: scartarne
+ * una parte falserebbe la stima senza che il chiamante se ne accorga.
+ */
+template <int MaxAnchors = 16>
+class FixedTDoAEKF {
+public:
+    static const int STATE_DIM = 7;
+    static const int MAX_ANCHORS = MaxAnchors;
+
+    typedef Matrix<double, STATE_DIM, 1> StateVector;
+    typedef Matrix<double, STATE_DIM, STATE_DIM> StateMatrix;
+    typedef TDoAEKF::Msmnt Msmnt;
+
+    FixedTDoAEKF() {
+        m_state.setZero();
+        m_P.setIdentity();
+        m_Q.setOnes();
+    }
+
+    void Init(const Vector3d& init_pos) {
+        m_state.setZero();
+        m_state.template segment<3>(0) = init_pos;
+
+        m_P.setIdentity();
+        m_P.template block<3,3>(0,0) *= 5.0;
+        m_P(6,6) = 500.0;
+
+        m_Q.setOnes();
+    }
+
+    void Predict(double dt) {
+        if (dt <= 0) return;
+
+        m_state.template segment<3>(0) += dt * m_state.template segment<3>(3);
+
+        // F * P * F^T con F = [I dt*I 0; 0 I 0; 0 0 1]
+        Matrix3d P_pv = m_P.template block<3,3>(0,3);
+        Matrix3d P_vv = m_P.template block<3,3>(3,3);
+        Vector3d P_vb = m_P.template block<3,1>(3,6);
+
+        m_P.template block<3,3>(0,0) += dt * (P_pv + P_pv.transpose()) + (dt * dt) * P_vv;
+        m_P.template block<3,3>(0,3) += dt * P_vv;
+        m_P.template block<3,3>(3,0) = m_P.template block<3,3>(0,3).transpose();
+        m_P.template block<3,1>(0,6) += dt * P_vb;
+        m_P.template block<1,3>(6,0) = m_P.template block<3,1>(0,6).transpose();
+
+        m_P.diagonal() += m_Q;
+    }
+
+    bool Update(const Msmnt* measurements, int count) {
+        if (count > MaxAnchors) return false;
+        if (count <= 0) return true;
+        const int n = count;
+
+        typedef Matrix<double, Dynamic, 1, 0, MaxAnchors, 1> MeasVector;
+        typedef Matrix<double, Dynamic, 4, RowMajor, MaxAnchors, 4> ReducedJacobian;
+        typedef Matrix<double, Dynamic, Dynamic, 0, MaxAnchors, MaxAnchors> InnovationMatrix;
+        typedef Matrix<double, Dynamic, STATE_DIM, 0, MaxAnchors, STATE_DIM> GainTranspose;
+
+        const Vector3d est_pos = m_state.template segment<3>(0);
+        const double est_bias = m_state(6);
+
+        // Righe di H ridotte alle colonne non nulle: [u_x u_y u_z 1]
+        MeasVector y(n);
+        ReducedJacobian Hr(n, 4);
+        for (int i = 0; i < n; ++i) {
+            const Msmnt& m = measurements[i];
+            Vector3d diff = est_pos - m.anchor_pos;
+            double geo_dist = diff.norm();
+            double pseudorange = (m.toa - m.tx_timestamp) * c;
+            y(i) = pseudorange - (geo_dist + est_bias);
+            Hr.template block<1,3>(i, 0) = (diff / (geo_dist + 1e-9)).transpose();
+            Hr(i, 3) = 1.0;
+        }
+
+        // Colonne di P su {x, y, z, bias}
+        Matrix<double, STATE_DIM, 4> Pc;
+        Pc.template leftCols<3>() = m_P.template leftCols<3>();
+        Pc.col(3) = m_P.col(6);
+        Matrix4d Pcc;
+        Pcc.template topRows<3>() = Pc.template topRows<3>();
+        Pcc.row(3) = Pc.row(6);
+
+        // HP = H * P (n x 7), S = H P H^T + R con R = 2 I
+        GainTranspose HP = Hr * Pc.transpose();
+        InnovationMatrix S = Hr * Pcc * Hr.transpose();
+        S.diagonal().array() += 2.0;
+
+        // K^T = S^-1 * H P
+        LLT<InnovationMatrix> llt(S);
+        GainTranspose Kt = llt.solve(HP);
+
+        m_state.noalias() += Kt.transpose() * y;
+        m_P.noalias() -= Kt.transpose() * HP;
+        return true;
+    }
+
+    bool Update(const vector<Msmnt>& measurements) {
+        return Update(measurements.data(), (int)measurements.size());
+    }
+
+    Vector3d GetPosition() const { return m_state.template segment<3>(0); }
+    StateVector GetState() const { return m_state; }
+    const StateMatrix& GetCovariance() const { return m_P; }
+
+private:
+    StateVector m_state;
+    StateMatrix m_P;
+    StateVector m_Q;
+    static constexpr double c = 299792458.0;
+};
+
+#endif
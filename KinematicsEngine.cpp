@@ -0,0 +1,76 @@
+#include "KinematicsEngine.h"
+#include <limits>
+
+using namespace Eigen;
+using namespace std;
+
+KinematicsEngine::KinematicsEngine(int num_drones) : m_time(0.0) {
+    Resize(num_drones);
+}
+
+void KinematicsEngine::Resize(int num_drones) {
+    m_trajectories.resize(num_drones);
+    m_positions.resize(num_drones, Vector3d::Zero());
+    m_position_time.resize(num_drones, std::numeric_limits<double>::quiet_NaN());
+}
+
+void KinematicsEngine::SetFormation(const TrajectoryTable& table) {
+    m_formation = table;
+    int rows = m_formation.GetNumRows();
+    m_formation_x.resize(rows);
+    m_formation_y.resize(rows);
+    m_formation_z.resize(rows);
+    for (int r = 0; r < rows; ++r) m_trajectories[m_formation.GetDroneId(r)] = nullptr;
+    EvaluateFormation();
+}
+
+void KinematicsEngine::SetTime(double time) {
+    if (time == m_time) return;
+    m_time = time;
+    EvaluateFormation();
+}
+
+void KinematicsEngine::EvaluateFormation() {
+    int rows = m_formation.GetNumRows();
+    if (rows == 0) return;
+    m_formation.Evaluate(m_time, m_formation_x.data(), m_formation_y.data(), m_formation_z.data());
+    for (int r = 0; r < rows; ++r) {
+        int id = m_formation.GetDroneId(r);
+        // Una legge assegnata con SetTrajectory dopo SetFormation ha la precedenza sulla tabella
+        if (m_trajectories[id]) continue;
+        m_positions[id] = Vector3d(m_formation_x[r], m_formation_y[r], m_formation_z[r]);
+        m_position_time[id] = m_time;
+    }
+}
+
+void KinematicsEngine::SetTrajectory(int id, Trajectory trajectory) {
+    m_trajectories[id] = std::move(trajectory);
+    m_position_time[id] = std::numeric_limits<double>::quiet_NaN();
+}
+
+const Vector3d& KinematicsEngine::GetPosition(int id) const {
+    if (m_position_time[id] != m_time && m_trajectories[id]) {
+        m_positions[id] = m_trajectories[id](m_time);
+        m_position_time[id] = m_time;
+    }
+    return m_positions[id];
+}
+
+void KinematicsEngine::SetPosition(int id, const Vector3d& position) {
+    m_positions[id] = position;
+    m_position_time[id] = m_time;
+}
+
+void KinematicsEngine::SaveState(CheckpointWriter& out) const {
+    out.Put<double>(m_time);
+    out.PutVector(m_positions);
+    out.PutVector(m_position_time);
+}
+
+bool KinematicsEngine::LoadState(CheckpointReader& in) {
+    const int64_t n = GetNumDrones();
+    m_time = in.Get<double>();
+    in.GetVector(m_positions, n);
+    in.GetVector(m_position_time, n);
+    return in.Ok();
+}
@@ -0,0 +1,61 @@
+#ifndef KINEMATICS_ENGINE_H
+#define KINEMATICS_ENGINE_H
+
+#include <Eigen/Dense>
+#include "Trajectories.h"
+#include "Checkpoint.h"
+#include <functional>
+#include <vector>
+
+using namespace Eigen;
+using namespace std;
+
+/**
+ * Posizioni vere dello sciame calcolate su richiesta.
+ *
+ * Lo scheduler porta il motore al tempo dello slot con SetTime. I droni descritti dalla
+ * TrajectoryTable della formazione vengono valutati tutti insieme in SetTime, con un solo
+ * passaggio sulla tabella; una traiettoria arbitraria (SetTrajectory) viene valutata solo
+ * quando la posizione viene letta. In entrambi i casi il risultato resta in cache finche'
+ * il tempo non cambia e corrisponde esattamente all'istante dello slot.
+ *
+ * GetPosition si puo' chiamare in parallelo per id diversi (ogni id ha la propria cache).
+ */
+class KinematicsEngine {
+public:
+    typedef std::function<Vector3d(double)> Trajectory;
+
+    explicit KinematicsEngine(int num_drones = 0);
+
+    void Resize(int num_drones);
+    int GetNumDrones() const { return (int)m_positions.size(); }
+
+    // Vale anche per un drone della formazione: la sua riga della tabella viene ignorata
+    void SetTrajectory(int id, Trajectory trajectory);
+    // Le righe della tabella sostituiscono le traiettorie dei rispettivi droni
+    void SetFormation(const TrajectoryTable& table);
+
+    void SetTime(double time);
+    double GetTime() const { return m_time; }
+
+    const Vector3d& GetPosition(int id) const;
+    // Sostituisce la posizione di id fino al prossimo cambio di tempo (senza traiettoria: per sempre)
+    void SetPosition(int id, const Vector3d& position);
+
+    // Tempo e posizioni in cache (comprese quelle sostituite con SetPosition); le leggi di
+    // moto non vengono salvate, si ricostruiscono dallo scenario
+    void SaveState(CheckpointWriter& out) const;
+    bool LoadState(CheckpointReader& in);
+
+private:
+    void EvaluateFormation();
+
+    vector<Trajectory> m_trajectories;
+    TrajectoryTable m_formation;
+    vector<double> m_formation_x, m_formation_y, m_formation_z;
+    mutable vector<Vector3d> m_positions;
+    mutable vector<double> m_position_time;   // istante a cui si riferisce m_positions[id]
+    double m_time;
+};
+
+#endif
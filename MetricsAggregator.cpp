@@ -0,0 +1,215 @@
+#include "MetricsAggregator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+namespace {
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+// JSON non ha NaN/inf: valori non definiti diventano null
+void PutNumber(FILE* f, const char* key, double v, const char* sep = ", ") {
+    if (std::isfinite(v)) fprintf(f, "\"%s\": %.6g%s", key, v, sep);
+    else fprintf(f, "\"%s\": null%s", key, sep);
+}
+}
+
+void StreamingMoments::Add(double x) {
+    if (n == 0) min = max = x;
+    ++n;
+    double delta = x - mean;
+    mean += delta / n;
+    m2 += delta * (x - mean);
+    sq_sum += x * x;
+    min = std::min(min, x);
+    max = std::max(max, x);
+}
+
+double StreamingMoments::Rms() const {
+    return n ? std::sqrt(sq_sum / n) : NaN;
+}
+
+LogHistogram::LogHistogram(int buckets_per_decade)
+    : m_buckets_per_decade(buckets_per_decade), m_count(0), m_min(NaN), m_max(NaN)
+{
+    int decades = (int)std::lround(std::log10(MAX_VALUE / MIN_VALUE));
+    m_counts.assign(decades * buckets_per_decade + 1, 0);
+}
+
+void LogHistogram::Add(double x) {
+    int b = 0;
+    if (x > MIN_VALUE) b = 1 + (int)(std::log10(x / MIN_VALUE) * m_buckets_per_decade);
+    b = std::min(b, (int)m_counts.size() - 1);
+    m_counts[b]++;
+    if (m_count == 0) m_min = m_max = x;
+    m_count++;
+    m_min = std::min(m_min, x);
+    m_max = std::max(m_max, x);
+}
+
+double LogHistogram::Quantile(double q) const {
+    if (m_count == 0) return NaN;
+    uint64_t target = (uint64_t)std::ceil(std::min(1.0, std::max(0.0, q)) * m_count);
+    target = std::max<uint64_t>(target, 1);
+    uint64_t seen = 0;
+    size_t b = 0;
+    for (; b < m_counts.size(); ++b) {
+        seen += m_counts[b];
+        if (seen >= target) break;
+    }
+    if (b == 0) return m_min;
+    // Centro geometrico del bucket [MIN * 10^((b-1)/k), MIN * 10^(b/k))
+    double center = MIN_VALUE * std::pow(10.0, (b - 0.5) / m_buckets_per_decade);
+    return std::min(std::max(center, m_min), m_max);
+}
+
+void MetricsAggregator::ErrorStats::Add(double estimation_error, bool alarm, bool ranging) {
+    observations++;
+    if (alarm) alarms++;
+    if (!ranging) return;
+    error.Add(estimation_error);
+    quantiles.Add(estimation_error);
+}
+
+MetricsAggregator::MetricsAggregator(int num_drones, double sim_time, double window_s)
+    : m_num_drones(num_drones), m_window_s(window_s > 0 ? window_s : sim_time), m_total(WINDOW_BUCKETS_PER_DECADE),
+      m_attacker(-1), m_attack_time(NaN), m_first_observer_alarm(NaN), m_first_consensus_alarm(NaN)
+{
+    m_pairs.assign((size_t)num_drones * num_drones, ErrorStats(PAIR_BUCKETS_PER_DECADE));
+    m_windows.resize((size_t)std::max(1.0, std::ceil(sim_time / m_window_s)) + 1);
+    m_senders.resize(num_drones);
+    m_observer_alarm_time.assign(num_drones, NaN);
+}
+
+MetricsAggregator::WindowStats& MetricsAggregator::Window(double time) {
+    size_t w = (size_t)std::max(0.0, std::floor(time / m_window_s));
+    // Solo se la run va oltre lo sim_time del costruttore (es. ripresa da checkpoint)
+    if (w >= m_windows.size()) m_windows.resize(w + 1);
+    return m_windows[w];
+}
+
+void MetricsAggregator::OnAttackStart(double time, int drone_id) {
+    m_attack_time = time;
+    m_attacker = drone_id;
+    m_first_observer_alarm = NaN;
+    m_first_consensus_alarm = NaN;
+    std::fill(m_observer_alarm_time.begin(), m_observer_alarm_time.end(), NaN);
+}
+
+void MetricsAggregator::AddObservation(double time, int sender, int observer, double estimation_error, bool alarm, bool ranging) {
+    m_total.Add(estimation_error, alarm, ranging);
+    m_pairs[(size_t)sender * m_num_drones + observer].Add(estimation_error, alarm, ranging);
+    Window(time).obs.Add(estimation_error, alarm, ranging);
+
+    if (alarm && sender == m_attacker && time >= m_attack_time) {
+        if (std::isnan(m_first_observer_alarm)) m_first_observer_alarm = time;
+        if (std::isnan(m_observer_alarm_time[observer])) m_observer_alarm_time[observer] = time;
+    }
+}
+
+void MetricsAggregator::AddDecision(double time, int sender, int vote_sum, bool consensus_alarm, double recovery_error) {
+    SenderStats& s = m_senders[sender];
+    s.decisions++;
+    s.vote_sum.Add(vote_sum);
+    s.recovery_error.Add(recovery_error);
+    WindowStats& w = Window(time);
+    w.decisions++;
+    if (consensus_alarm) {
+        s.consensus_alarms++;
+        w.consensus_alarms++;
+        if (sender == m_attacker && time >= m_attack_time && std::isnan(m_first_consensus_alarm)) m_first_consensus_alarm = time;
+    }
+}
+
+double MetricsAggregator::ObserverAlarmLatency() const {
+    return m_first_observer_alarm - m_attack_time;
+}
+
+double MetricsAggregator::ConsensusAlarmLatency() const {
+    return m_first_consensus_alarm - m_attack_time;
+}
+
+static void PutErrorStats(FILE* f, const StreamingMoments& e, const LogHistogram& quantiles,
+                          uint64_t observations, uint64_t alarms) {
+    fprintf(f, "\"observations\": %llu, ", (unsigned long long)observations);
+    PutNumber(f, "alarm_rate", observations ? (double)alarms / observations : NaN);
+    PutNumber(f, "rmse", e.Rms());
+    PutNumber(f, "mean", e.n ? e.mean : NaN);
+    PutNumber(f, "std", e.n > 1 ? std::sqrt(e.Variance()) : NaN);
+    PutNumber(f, "max", e.n ? e.max : NaN);
+    PutNumber(f, "p50", quantiles.Quantile(0.5));
+    PutNumber(f, "p95", quantiles.Quantile(0.95), "");
+}
+
+bool MetricsAggregator::WriteSummary(const string& path, string& error) const {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        error = "cannot write " + path;
+        return false;
+    }
+
+    fprintf(f, "{\n  \"drones\": %d,\n  \"window_s\": %g,\n", m_num_drones, m_window_s);
+    fprintf(f, "  \"total\": {");
+    PutErrorStats(f, m_total.error, m_total.quantiles, m_total.observations, m_total.alarms);
+    fprintf(f, "},\n");
+
+    // Latenza media degli osservatori che hanno segnalato l'attaccante
+    StreamingMoments observer_latency;
+    for (double t : m_observer_alarm_time)
+        if (!std::isnan(t)) observer_latency.Add(t - m_attack_time);
+    fprintf(f, "  \"detection\": {\"attacker\": %d, ", m_attacker);
+    PutNumber(f, "attack_time", m_attack_time);
+    PutNumber(f, "first_observer_alarm_latency", ObserverAlarmLatency());
+    PutNumber(f, "consensus_alarm_latency", ConsensusAlarmLatency());
+    fprintf(f, "\"observers_alarmed\": %llu, ", (unsigned long long)observer_latency.n);
+    PutNumber(f, "mean_observer_latency", observer_latency.n ? observer_latency.mean : NaN, "");
+    fprintf(f, "},\n");
+
+    fprintf(f, "  \"windows\": [\n");
+    bool first = true;
+    for (size_t w = 0; w < m_windows.size(); ++w) {
+        const WindowStats& ws = m_windows[w];
+        if (ws.obs.observations == 0 && ws.decisions == 0) continue;
+        fprintf(f, "%s    {\"start\": %g, \"decisions\": %llu, \"consensus_alarms\": %llu, ", first ? "" : ",\n",
+                w * m_window_s, (unsigned long long)ws.decisions, (unsigned long long)ws.consensus_alarms);
+        PutErrorStats(f, ws.obs.error, ws.obs.quantiles, ws.obs.observations, ws.obs.alarms);
+        fprintf(f, "}");
+        first = false;
+    }
+    fprintf(f, "\n  ],\n");
+
+    fprintf(f, "  \"senders\": [\n");
+    first = true;
+    for (int s = 0; s < m_num_drones; ++s) {
+        const SenderStats& ss = m_senders[s];
+        if (ss.decisions == 0) continue;
+        fprintf(f, "%s    {\"sender\": %d, \"decisions\": %llu, \"consensus_alarms\": %llu, ", first ? "" : ",\n", s,
+                (unsigned long long)ss.decisions, (unsigned long long)ss.consensus_alarms);
+        PutNumber(f, "mean_vote_sum", ss.vote_sum.mean);
+        PutNumber(f, "min_vote_sum", ss.vote_sum.min);
+        PutNumber(f, "mean_recovery_error", ss.recovery_error.mean);
+        PutNumber(f, "max_recovery_error", ss.recovery_error.max, "");
+        fprintf(f, "}");
+        first = false;
+    }
+    fprintf(f, "\n  ],\n");
+
+    fprintf(f, "  \"pairs\": [\n");
+    first = true;
+    for (int s = 0; s < m_num_drones; ++s) {
+        for (int o = 0; o < m_num_drones; ++o) {
+            const ErrorStats& es = m_pairs[(size_t)s * m_num_drones + o];
+            if (es.observations == 0) continue;
+            fprintf(f, "%s    {\"sender\": %d, \"observer\": %d, ", first ? "" : ",\n", s, o);
+            PutErrorStats(f, es.error, es.quantiles, es.observations, es.alarms);
+            fprintf(f, "}");
+            first = false;
+        }
+    }
+    fprintf(f, "\n  ]\n}\n");
+
+    bool ok = !ferror(f);
+    if (fclose(f) != 0) ok = false;
+    if (!ok) error = "error writing " + path;
+    return ok;
+}
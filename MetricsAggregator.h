@@ -0,0 +1,131 @@
+#ifndef METRICS_AGGREGATOR_H
+#define METRICS_AGGREGATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Media, varianza (Welford), minimo, massimo e media dei quadrati di un flusso di valori,
+ * in O(1) per campione e senza memorizzare i campioni.
+ */
+struct StreamingMoments {
+    uint64_t n = 0;
+    double mean = 0.0, m2 = 0.0, sq_sum = 0.0;
+    double min = 0.0, max = 0.0;
+
+    void Add(double x);
+    double Variance() const { return n > 1 ? m2 / (n - 1) : 0.0; }
+    double Rms() const;
+};
+
+/**
+ * Sketch dei quantili a bucket logaritmici: buckets_per_decade bucket per decade tra
+ * MIN_VALUE e MAX_VALUE (valori fuori scala nei bucket estremi), conteggi a 32 bit allocati
+ * nel costruttore e Add in O(1). Il quantile e' il centro geometrico del bucket che lo
+ * contiene, limitato al minimo e al massimo visti: errore relativo entro 10^(1/(2 b)) - 1,
+ * ~1% con 100 bucket per decade, ~12% con 10. A differenza degli stimatori a marcatori
+ * (P^2) non dipende dall'ordine dei campioni, quindi regge il transitorio di convergenza
+ * degli EKF a inizio run.
+ */
+class LogHistogram {
+public:
+    static constexpr double MIN_VALUE = 1e-3;
+    static constexpr double MAX_VALUE = 1e6;
+
+    explicit LogHistogram(int buckets_per_decade);
+
+    void Add(double x);
+    uint64_t Count() const { return m_count; }
+    // Quantile q in [0, 1]; NaN senza campioni
+    double Quantile(double q) const;
+
+private:
+    int m_buckets_per_decade;
+    vector<uint32_t> m_counts;     // [0] = fino a MIN_VALUE
+    uint64_t m_count;
+    double m_min, m_max;
+};
+
+/**
+ * Indicatori della run calcolati in streaming dentro il simulatore, senza passare dal log
+ * delle osservazioni: lo scheduler consegna ogni osservazione (errore di stima e allarme di
+ * un osservatore sul trasmettitore) e ogni decisione di consenso (somma dei voti, allarme,
+ * errore della posizione recuperata), la SwarmSimulation l'istante in cui parte l'attacco.
+ *
+ * Si accumulano, ciascuno con media, varianza, RMSE e quantili (mediana e p95) dell'errore:
+ *   - per coppia (sender, observer), con uno sketch a 10 bucket per decade: 91 conteggi a 32 bit
+ *     (364 byte) piu' sizeof(ErrorStats) (120 byte su x86-64), ~480 byte a coppia
+ *   - per finestra di window_s secondi di simulazione e sull'intera run, a 100 bucket per decade
+ * e per ogni trasmettitore voti, allarmi di consenso ed errore di recupero. La latenza di
+ * rilevamento parte da OnAttackStart (il SetMalicious) e arriva al primo allarme di un
+ * osservatore e al primo allarme di consenso sull'attaccante.
+ *
+ * Come RunStats le osservazioni degli slot di sola sincronizzazione (Master Anchor con
+ * clock_sync = master) non entrano nell'errore di stima. Tutta la memoria e' allocata nel
+ * costruttore: a regime AddObservation e AddDecision non allocano.
+ */
+class MetricsAggregator {
+public:
+    MetricsAggregator(int num_drones, double sim_time, double window_s);
+
+    void OnAttackStart(double time, int drone_id);
+    void AddObservation(double time, int sender, int observer, double estimation_error, bool alarm, bool ranging);
+    void AddDecision(double time, int sender, int vote_sum, bool consensus_alarm, double recovery_error);
+
+    double AttackTime() const { return m_attack_time; }
+    // NaN finche' l'attacco non e' partito o non e' stato rilevato
+    double ObserverAlarmLatency() const;
+    double ConsensusAlarmLatency() const;
+    const StreamingMoments& GetError() const { return m_total.error; }
+
+    // Riepilogo JSON (globale, rilevamento, finestre, trasmettitori, coppie)
+    bool WriteSummary(const string& path, string& error) const;
+
+private:
+    static const int PAIR_BUCKETS_PER_DECADE = 10;
+    static const int WINDOW_BUCKETS_PER_DECADE = 100;
+
+    struct ErrorStats {
+        explicit ErrorStats(int buckets_per_decade) : quantiles(buckets_per_decade) {}
+
+        StreamingMoments error;
+        LogHistogram quantiles;
+        uint64_t observations = 0;
+        uint64_t alarms = 0;
+
+        void Add(double estimation_error, bool alarm, bool ranging);
+    };
+    struct WindowStats {
+        WindowStats() : obs(WINDOW_BUCKETS_PER_DECADE) {}
+
+        ErrorStats obs;
+        uint64_t decisions = 0;
+        uint64_t consensus_alarms = 0;
+    };
+    struct SenderStats {
+        uint64_t decisions = 0;
+        uint64_t consensus_alarms = 0;
+        StreamingMoments vote_sum;
+        StreamingMoments recovery_error;
+    };
+
+    WindowStats& Window(double time);
+
+    int m_num_drones;
+    double m_window_s;
+    ErrorStats m_total;
+    vector<ErrorStats> m_pairs;          // sender * N + observer
+    vector<WindowStats> m_windows;
+    vector<SenderStats> m_senders;
+
+    int m_attacker;
+    double m_attack_time;
+    double m_first_observer_alarm;
+    double m_first_consensus_alarm;
+    vector<double> m_observer_alarm_time;   // primo allarme di ogni osservatore sull'attaccante
+};
+
+#endif
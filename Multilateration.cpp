@@ -0,0 +1,136 @@
+#include "Multilateration.h"
+#include <cmath>
+#include <limits>
+
+using namespace Eigen;
+
+namespace {
+
+const double C_LIGHT = 299792458.0;
+const int MIN_MEASUREMENTS = 4;
+const int REFINE_ITERATIONS = 3;
+
+// Prodotto di Lorentz <u, v> = u_x v_x + u_y v_y + u_z v_z - u_w v_w
+inline double Lorentz(const Vector4d& u, const Vector4d& v) {
+    return u.head<3>().dot(v.head<3>()) - u(3) * v(3);
+}
+
+}
+
+bool SolveMultilateration(const RangingMeasurement* measurements, int count, double tx_timestamp,
+                          MultilaterationFix& fix, const uint8_t* keep, int keep_stride, int keep_column)
+{
+    auto used = [&](int m) { return !keep || keep[(size_t)m * keep_stride + keep_column] != 0; };
+    auto pseudorange = [&](int m) { return (measurements[m].toa_seconds - tx_timestamp) * C_LIGHT; };
+
+    // Ancore centrate sul baricentro: i termini quadratici restano piccoli e il sistema ben condizionato
+    Vector3d center = Vector3d::Zero();
+    int n = 0;
+    for (int m = 0; m < count; ++m) {
+        if (!used(m)) continue;
+        center += measurements[m].anchor_pos;
+        n++;
+    }
+    if (n < MIN_MEASUREMENTS) return false;
+    center /= n;
+
+    // Bancroft: con a_i = [s_i; rho_i], y = [p; b] vale <a_i, y> = <a_i, a_i>/2 + lambda, lambda = <y, y>/2.
+    // Le righe g_i = M a_i (M = diag(1,1,1,-1)) danno y = u + lambda v ai minimi quadrati
+    Matrix4d gtg = Matrix4d::Zero();
+    Vector4d g_alpha = Vector4d::Zero(), g_one = Vector4d::Zero();
+    for (int m = 0; m < count; ++m) {
+        if (!used(m)) continue;
+        Vector4d a;
+        a << measurements[m].anchor_pos - center, pseudorange(m);
+        Vector4d g(a(0), a(1), a(2), -a(3));
+        gtg += g * g.transpose();
+        g_alpha += g * (0.5 * Lorentz(a, a));
+        g_one += g;
+    }
+    LDLT<Matrix4d> normal(gtg);
+    if (normal.info() != Success || !normal.isPositive()) return false;
+    Vector4d u = normal.solve(g_alpha);
+    Vector4d v = normal.solve(g_one);
+
+    // lambda = <u + lambda v, u + lambda v> / 2
+    double qa = 0.5 * Lorentz(v, v), qb = Lorentz(u, v) - 1.0, qc = 0.5 * Lorentz(u, u);
+    double roots[2];
+    int n_roots = 2;
+    if (std::abs(qa) < 1e-12) {
+        roots[0] = -qc / qb;
+        n_roots = 1;
+    } else {
+        double disc = qb * qb - 4.0 * qa * qc;
+        double sq = disc > 0 ? std::sqrt(disc) : 0.0;   // discriminante negativo per il rumore: radice doppia
+        roots[0] = (-qb + sq) / (2.0 * qa);
+        roots[1] = (-qb - sq) / (2.0 * qa);
+    }
+
+    auto residual_sq = [&](const Vector3d& p, double b) {
+        double sum = 0.0;
+        for (int m = 0; m < count; ++m) {
+            if (!used(m)) continue;
+            double r = pseudorange(m) - ((p - (measurements[m].anchor_pos - center)).norm() + b);
+            sum += r * r;
+        }
+        return sum;
+    };
+
+    // Gauss-Newton sul modello non quadrato: J_i = [ (p - s_i)^T / |p - s_i|, 1 ]
+    auto refine = [&](Vector3d& p, double& b) {
+        for (int it = 0; it < REFINE_ITERATIONS; ++it) {
+            Matrix4d jtj = Matrix4d::Zero();
+            Vector4d jtr = Vector4d::Zero();
+            for (int m = 0; m < count; ++m) {
+                if (!used(m)) continue;
+                Vector3d diff = p - (measurements[m].anchor_pos - center);
+                double dist = diff.norm();
+                Vector4d j;
+                j << diff / (dist + 1e-9), 1.0;
+                jtj += j * j.transpose();
+                jtr += j * (pseudorange(m) - (dist + b));
+            }
+            LDLT<Matrix4d> step(jtj);
+            if (step.info() != Success) return;
+            Vector4d delta = step.solve(jtr);
+            p += delta.head<3>();
+            b += delta(3);
+        }
+    };
+
+    // Entrambe le radici vengono rifinite: con poche ancore la radice sbagliata puo' avere
+    // un residuo iniziale simile e separarsi solo dopo Gauss-Newton
+    Vector3d p = Vector3d::Zero();
+    double b = 0.0, best = std::numeric_limits<double>::infinity();
+    for (int k = 0; k < n_roots; ++k) {
+        Vector4d y = u + roots[k] * v;
+        Vector3d pk = y.head<3>();
+        double bk = y(3);
+        refine(pk, bk);
+        double cost = residual_sq(pk, bk);
+        if (cost < best) {
+            best = cost;
+            p = pk;
+            b = bk;
+        }
+    }
+
+    // Diluizione della precisione in posizione nel punto trovato: errore atteso / rumore di misura
+    Matrix4d jtj = Matrix4d::Zero();
+    for (int m = 0; m < count; ++m) {
+        if (!used(m)) continue;
+        Vector3d diff = p - (measurements[m].anchor_pos - center);
+        Vector4d j;
+        j << diff / (diff.norm() + 1e-9), 1.0;
+        jtj += j * j.transpose();
+    }
+    FullPivLU<Matrix4d> lu(jtj);
+    fix.pdop = lu.isInvertible() ? std::sqrt(lu.inverse().topLeftCorner<3,3>().trace())
+                                 : std::numeric_limits<double>::infinity();
+
+    fix.position = p + center;
+    fix.bias = b;
+    fix.residual_rms = std::sqrt(best / n);
+    fix.num_measurements = n;
+    return fix.position.allFinite() && std::isfinite(fix.bias) && std::isfinite(fix.residual_rms);
+}
@@ -0,0 +1,37 @@
+#ifndef MULTILATERATION_H
+#define MULTILATERATION_H
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include "UWBMessage.h"
+
+using namespace Eigen;
+
+/**
+ * Fix di posizione in forma chiusa dalle pseudorange di un solo slot, senza stato e
+ * senza ipotesi iniziale (in particolare senza il GPS dichiarato dal trasmettitore).
+ *
+ * Modello: rho_i = (toa_i - tx_timestamp) * c = |p - a_i| + b, con b bias di clock comune.
+ * La soluzione di Bancroft risolve le equazioni quadrate come problema lineare ai minimi
+ * quadrati piu' un'equazione di secondo grado in <y, y> (prodotto di Lorentz); delle due
+ * radici si tiene quella con il residuo minore sulle equazioni non quadrate, poi qualche
+ * iterazione di Gauss-Newton (Taylor) rifinisce p e b. Servono almeno 4 ancore non complanari.
+ *
+ * Tutto su matrici 4x4 fisse: nessuna allocazione, costo lineare nel numero di misure.
+ */
+struct MultilaterationFix {
+    Vector3d position;
+    double bias;            // metri
+    double residual_rms;    // metri, sulle misure usate
+    double pdop;            // diluizione della precisione in posizione (infinito se degenere)
+    int num_measurements;
+};
+
+// keep come in SwarmFilterBank::TransmitterBatch: usa la misura m solo se
+// keep[m * keep_stride + keep_column] != 0 (nullptr = tutte). False se le misure sono
+// meno di 4, la geometria e' degenere o il risultato non e' finito
+bool SolveMultilateration(const RangingMeasurement* measurements, int count, double tx_timestamp,
+                          MultilaterationFix& fix, const uint8_t* keep = nullptr, int keep_stride = 0,
+                          int keep_column = 0);
+
+#endif
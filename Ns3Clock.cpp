@@ -0,0 +1,12 @@
+#include "Ns3Clock.h"
+
+using namespace ns3;
+
+void Ns3Clock::Schedule(double delay_s, std::function<void()> fn) {
+    Simulator::Schedule(Seconds(delay_s), fn);
+}
+
+void Ns3Clock::Run(double stop_time_s) {
+    Simulator::Stop(Seconds(stop_time_s) - Simulator::Now());
+    Simulator::Run();
+}
@@ -0,0 +1,20 @@
+#ifndef NS3_CLOCK_H
+#define NS3_CLOCK_H
+
+#include "ns3/core-module.h"
+#include "SimClock.h"
+
+/**
+ * SimClock sul Simulator di ns-3. Il Simulator e' un singleton di processo: una sola run
+ * alla volta. Run() si puo' richiamare con istanti crescenti; Simulator::Destroy() nel distruttore.
+ */
+class Ns3Clock : public SimClock {
+public:
+    ~Ns3Clock() override { ns3::Simulator::Destroy(); }
+
+    int64_t NowPicoSeconds() const override { return ns3::Simulator::Now().GetPicoSeconds(); }
+    void Schedule(double delay_s, std::function<void()> fn) override;
+    void Run(double stop_time_s) override;
+};
+
+#endif
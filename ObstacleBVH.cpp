@@ -0,0 +1,115 @@
+#include "ObstacleBVH.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace Eigen;
+using namespace std;
+
+namespace {
+
+// Intersezione del segmento a + t d, t in [0, 1], con il box [lo, hi]
+inline bool SegmentHitsBox(const Vector3d& a, const Vector3d& d, const Vector3d& inv_d,
+                           const Vector3d& lo, const Vector3d& hi) {
+    double t0 = 0.0, t1 = 1.0;
+    for (int k = 0; k < 3; ++k) {
+        if (d(k) == 0.0) {
+            if (a(k) < lo(k) || a(k) > hi(k)) return false;
+            continue;
+        }
+        double ta = (lo(k) - a(k)) * inv_d(k);
+        double tb = (hi(k) - a(k)) * inv_d(k);
+        if (ta > tb) std::swap(ta, tb);
+        t0 = std::max(t0, ta);
+        t1 = std::min(t1, tb);
+        if (t0 > t1) return false;
+    }
+    return true;
+}
+
+inline bool SegmentHitsSphere(const Vector3d& a, const Vector3d& d, double dd, const ObstacleBVH::Sphere& s) {
+    Vector3d ac = s.center - a;
+    double t = dd > 0.0 ? std::min(1.0, std::max(0.0, ac.dot(d) / dd)) : 0.0;
+    return (ac - t * d).squaredNorm() <= s.radius * s.radius;
+}
+
+}
+
+void ObstacleBVH::Build(const vector<Sphere>& spheres) {
+    m_spheres = spheres;
+    m_nodes.clear();
+    if (m_spheres.empty()) return;
+    m_nodes.reserve(2 * m_spheres.size() / LEAF_SIZE + 2);
+    BuildRange(0, (int)m_spheres.size());
+}
+
+int ObstacleBVH::BuildRange(int begin, int end) {
+    int idx = (int)m_nodes.size();
+    m_nodes.emplace_back();
+
+    Vector3d lo = Vector3d::Constant(INFINITY), hi = Vector3d::Constant(-INFINITY);
+    Vector3d clo = lo, chi = hi;
+    for (int i = begin; i < end; ++i) {
+        const Sphere& s = m_spheres[i];
+        lo = lo.cwiseMin(s.center - Vector3d::Constant(s.radius));
+        hi = hi.cwiseMax(s.center + Vector3d::Constant(s.radius));
+        clo = clo.cwiseMin(s.center);
+        chi = chi.cwiseMax(s.center);
+    }
+    m_nodes[idx].lo = lo;
+    m_nodes[idx].hi = hi;
+
+    if (end - begin <= LEAF_SIZE) {
+        m_nodes[idx].first = begin;
+        m_nodes[idx].count = end - begin;
+        return idx;
+    }
+
+    int axis;
+    (chi - clo).maxCoeff(&axis);
+    int mid = (begin + end) / 2;
+    std::nth_element(m_spheres.begin() + begin, m_spheres.begin() + mid, m_spheres.begin() + end,
+                     [axis](const Sphere& x, const Sphere& y) { return x.center(axis) < y.center(axis); });
+
+    BuildRange(begin, mid);               // figlio sinistro = idx + 1
+    int right = BuildRange(mid, end);
+    m_nodes[idx].first = right;
+    m_nodes[idx].count = 0;
+    return idx;
+}
+
+bool ObstacleBVH::Traverse(const Vector3d& a, const Vector3d& d, const Vector3d& inv_d) const {
+    const double dd = d.squaredNorm();
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = m_nodes[stack[--top]];
+        if (!SegmentHitsBox(a, d, inv_d, node.lo, node.hi)) continue;
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                if (SegmentHitsSphere(a, d, dd, m_spheres[i])) return true;
+            }
+        } else {
+            stack[top++] = node.first;
+            stack[top++] = (int)(&node - m_nodes.data()) + 1;
+        }
+    }
+    return false;
+}
+
+bool ObstacleBVH::SegmentBlocked(const Vector3d& a, const Vector3d& b) const {
+    if (m_nodes.empty()) return false;
+    Vector3d d = b - a;
+    return Traverse(a, d, d.cwiseInverse());
+}
+
+void ObstacleBVH::SegmentsBlocked(const Vector3d& origin, const Vector3d* ends, int n, uint8_t* blocked) const {
+    if (m_nodes.empty()) {
+        std::fill(blocked, blocked + n, 0);
+        return;
+    }
+    for (int i = 0; i < n; ++i) {
+        Vector3d d = ends[i] - origin;
+        blocked[i] = Traverse(origin, d, d.cwiseInverse()) ? 1 : 0;
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef OBSTACLE_BVH_H
+#define OBSTACLE_BVH_H
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <vector>
+
+using namespace Eigen;
+using namespace std;
+
+/**
+ * Bounding Volume Hierarchy (AABB) sugli ostacoli sferici del canale UWB.
+ *
+ * L'albero e' costruito top-down con split sulla mediana dell'asse piu' lungo dei centri
+ * e memorizzato in un array piatto (figlio sinistro subito dopo il padre), le sfere sono
+ * riordinate per foglia. SegmentBlocked e' una query "any hit": si ferma alla prima sfera
+ * che interseca il segmento, quindi un link costa O(log n) nodi visitati invece di O(n).
+ */
+class ObstacleBVH {
+public:
+    struct Sphere {
+        Vector3d center;
+        double radius;
+    };
+
+    void Build(const vector<Sphere>& spheres);
+    bool Empty() const { return m_nodes.empty(); }
+    size_t GetNumObstacles() const { return m_spheres.size(); }
+
+    // true se il segmento a-b attraversa almeno un ostacolo
+    bool SegmentBlocked(const Vector3d& a, const Vector3d& b) const;
+
+    // blocked[i] = SegmentBlocked(origin, ends[i]) per n segmenti con la stessa origine
+    void SegmentsBlocked(const Vector3d& origin, const Vector3d* ends, int n, uint8_t* blocked) const;
+
+private:
+    struct Node {
+        Vector3d lo, hi;
+        int first;   // foglia: prima sfera; nodo interno: indice del figlio destro
+        int count;   // 0 per i nodi interni
+    };
+    static const int LEAF_SIZE = 4;
+
+    int BuildRange(int begin, int end);
+    bool Traverse(const Vector3d& a, const Vector3d& d, const Vector3d& inv_d) const;
+
+    vector<Node> m_nodes;
+    vector<Sphere> m_spheres;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include "ReplayEngine.h"
+#include "Scenario.h"
+
+using namespace std;
+using namespace Eigen;
+
+ReplayEngine::ReplayEngine(int num_drones)
+    : m_bank(num_drones), m_pool(nullptr), m_decisions(nullptr), m_loss_rate(0.0)
+{
+    for (int i = 0; i < num_drones; ++i) {
+        auto d = make_unique<Drone>();
+        d->SetId(i);
+        d->SetFilterBank(&m_bank);
+        m_swarm.push_back(std::move(d));
+    }
+    m_stats.alarms_by_sender.assign(num_drones, 0);
+    m_stats.first_alarm_time.assign(num_drones, -1.0);
+}
+
+void ReplayEngine::SetPacketLoss(double rate, uint64_t seed) {
+    m_loss_rate = rate;
+    m_drop_rng.clear();
+    for (int i = 0; i < (int)m_swarm.size(); ++i) m_drop_rng.emplace_back(DeriveSeed(seed, STREAM_PACKET_LOSS + i));
+}
+
+void ReplayEngine::SetDecisionLog(ostream* out) {
+    m_decisions = out;
+    if (m_decisions) *m_decisions << "time,sender,votes,alarm,rec_x,rec_y,rec_z\n";
+}
+
+void ReplayEngine::ProcessSlot(const SlotRecord& rec) {
+    const int tx_id = rec.sender_id;
+    const int n_drones = (int)m_swarm.size();
+
+    SwarmFilterBank::TransmitterBatch batch;
+    batch.target = tx_id;
+    batch.claimed_gps = rec.claimed_gps;
+    batch.measurements = rec.measurements.data();
+    batch.num_measurements = (int)rec.measurements.size();
+    const bool lossy = m_loss_rate > 0.0;
+    if (lossy) m_keep_mask.resize(rec.measurements.size() * n_drones);
+    batch.keep = lossy ? m_keep_mask.data() : nullptr;
+    batch.keep_stride = lossy ? n_drones : 0;
+    batch.current_time = rec.time;
+    batch.tx_timestamp = rec.tx_timestamp;
+
+    // Stessa regola di TDMAScheduler::BuildReceiveMask: la propria misura arriva sempre,
+    // le altre si perdono con probabilita' m_loss_rate. Ogni osservatore scrive solo la sua colonna
+    auto update = [&](int begin, int end) {
+        for (int o = begin; o < end && lossy; ++o) {
+            if (o == tx_id) continue;
+            std::uniform_real_distribution<> drop_chance(0.0, 1.0);
+            for (size_t k = 0; k < rec.measurements.size(); ++k) {
+                bool received = ((int)rec.measurements[k].anchor_id == o) || (drop_chance(m_drop_rng[o]) > m_loss_rate);
+                m_keep_mask[k * n_drones + o] = received ? 1 : 0;
+            }
+        }
+        m_bank.ProcessTransmitter(batch, begin, end);
+    };
+    if (m_pool) m_pool->ParallelFor(n_drones, SwarmFilterBank::LANE_BLOCK, update);
+    else update(0, n_drones);
+
+    int total_votes = m_bank.GetConsensus().VoteSum(tx_id);
+    bool alarm = total_votes <= SwarmConsensus::ALARM_VOTE_SUM;
+    Vector3d recovered_pos = rec.claimed_gps;
+    if (alarm) {
+        m_peer_estimates.clear();
+        for (int o = 0; o < n_drones; ++o) {
+            if (o != tx_id) m_peer_estimates.push_back(m_swarm[o]->GetEstimatedPositionOf(tx_id));
+        }
+        recovered_pos = m_swarm[0]->GetRecoveredPosition(m_peer_estimates.data(), (int)m_peer_estimates.size());
+        m_swarm[tx_id]->SetInitialPosition(rec.claimed_gps);
+        m_swarm[tx_id]->ResetState(recovered_pos);
+
+        m_stats.alarms++;
+        m_stats.alarms_by_sender[tx_id]++;
+        if (m_stats.first_alarm_time[tx_id] < 0) m_stats.first_alarm_time[tx_id] = rec.time;
+    }
+
+    if (m_stats.slots == 0) m_stats.first_time = rec.time;
+    m_stats.last_time = rec.time;
+    m_stats.slots++;
+    m_stats.measurements += rec.measurements.size();
+
+    if (m_decisions) {
+        *m_decisions << rec.time << "," << tx_id << "," << total_votes << "," << (alarm ? 1 : 0) << ","
+                     << recovered_pos.x() << "," << recovered_pos.y() << "," << recovered_pos.z() << "\n";
+    }
+}
+
+bool ReplayEngine::Run(SlotRecordReader& reader, string& error) {
+    SlotRecord rec;
+    while (reader.Next(rec)) ProcessSlot(rec);
+    error = reader.GetError();
+    return error.empty();
+}
@@ -0,0 +1,75 @@
+#ifndef REPLAY_ENGINE_H
+#define REPLAY_ENGINE_H
+
+#include "Drone.h"
+#include "SwarmFilterBank.h"
+#include "SlotRecord.h"
+#include "WorkerPool.h"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace Eigen;
+
+/**
+ * Rilevatore SwarmRaft alimentato da slot registrati invece che dal canale simulato.
+ *
+ * Ogni SlotRecord passa dalla stessa pipeline di TDMAScheduler::ExecuteSlot: update degli
+ * EKF di tutti gli osservatori con le misure dello slot (SwarmFilterBank, a blocchi di
+ * LANE_BLOCK come lo scheduler), voto sul trasmettitore e, in caso di allarme, posizione
+ * recuperata con Drone::GetRecoveredPosition e Drone::ResetState.
+ *
+ * Non esiste una posizione vera: per ResetState la posizione fisica del trasmettitore e'
+ * quella che ha dichiarato nello slot. I record non portano la maschera di ricezione per
+ * osservatore: di default ogni misura arriva a tutti gli osservatori, mentre nel simulatore
+ * ogni osservatore perde i pacchetti condivisi con probabilita' packet_loss_rate e, con la
+ * portata limitata, riceve solo gli slot in range. SetPacketLoss riapplica la stessa regola
+ * di perdita di TDMAScheduler::BuildReceiveMask (stessa distribuzione, non gli stessi
+ * pacchetti persi); la portata non viene riprodotta. Non c'e' un orologio: gli slot vengono
+ * processati appena letti, alla velocita' della CPU.
+ */
+class ReplayEngine {
+public:
+    struct Stats {
+        uint64_t slots = 0;
+        uint64_t measurements = 0;
+        uint64_t alarms = 0;
+        double first_time = 0.0, last_time = 0.0;
+        vector<uint64_t> alarms_by_sender;
+        vector<double> first_alarm_time;   // -1 = mai in allarme
+    };
+
+    explicit ReplayEngine(int num_drones);
+
+    void SetWorkerPool(WorkerPool* pool) { m_pool = pool; }
+    void SetInnovationGate(double n_sigma) { m_bank.SetInnovationGate(n_sigma); }
+    void SetInitMode(SwarmFilterBank::InitMode mode) { m_bank.SetInitMode(mode); }
+    // Perdita dei pacchetti condivisi per osservatore come nel simulatore (0 = nessuna perdita)
+    void SetPacketLoss(double rate, uint64_t seed);
+    // Una riga CSV per slot: time,sender,votes,alarm,rec_x,rec_y,rec_z (nullptr = nessuna)
+    void SetDecisionLog(ostream* out);
+
+    void ProcessSlot(const SlotRecord& rec);
+    // Processa tutto il file; false (con messaggio in error) se il file e' corrotto
+    bool Run(SlotRecordReader& reader, string& error);
+
+    int GetNumDrones() const { return (int)m_swarm.size(); }
+    const Stats& GetStats() const { return m_stats; }
+    const SwarmFilterBank& GetFilterBank() const { return m_bank; }
+
+private:
+    SwarmFilterBank m_bank;
+    vector<unique_ptr<Drone>> m_swarm;
+    WorkerPool* m_pool;
+    ostream* m_decisions;
+    Stats m_stats;
+    vector<Vector3d> m_peer_estimates;
+    double m_loss_rate;
+    vector<std::mt19937> m_drop_rng;   // uno per osservatore, come in TDMAScheduler
+    vector<uint8_t> m_keep_mask;       // keep[m * N + observer]
+};
+
+#endif
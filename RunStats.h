@@ -0,0 +1,44 @@
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+/**
+ * Indicatori di una singola run, accumulati dal TDMAScheduler slot per slot:
+ *   rmse              errore di stima EKF su tutte le coppie (sender, observer), Master Anchor escluso
+ *   alarm latency     dal SetMalicious al primo allarme di consenso sul drone malevolo
+ *   false alarm rate  allarmi di consenso contro droni onesti / decisioni su droni onesti
+ *   recovery error    errore medio della posizione recuperata del drone malevolo sotto attacco
+ */
+struct RunStats {
+    uint64_t observations = 0;
+    double sq_error_sum = 0.0;
+
+    double attack_time = -1.0;
+    double first_alarm_time = -1.0;
+
+    uint64_t honest_decisions = 0;
+    uint64_t false_alarms = 0;
+
+    uint64_t recovery_samples = 0;
+    double recovery_error_sum = 0.0;
+
+    double Rmse() const {
+        return observations ? std::sqrt(sq_error_sum / observations) : 0.0;
+    }
+    // NaN se l'attacco non e' mai stato rilevato
+    double AlarmLatency() const {
+        if (attack_time < 0 || first_alarm_time < 0) return std::numeric_limits<double>::quiet_NaN();
+        return first_alarm_time - attack_time;
+    }
+    double FalseAlarmRate() const {
+        return honest_decisions ? (double)false_alarms / honest_decisions : 0.0;
+    }
+    double RecoveryError() const {
+        return recovery_samples ? recovery_error_sum / recovery_samples : std::numeric_limits<double>::quiet_NaN();
+    }
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include "Scenario.h"
+#include "Trajectories.h"
+#include <fstream>
+#include <random>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+
+string Trim(const string& s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+bool ParseObstacle(const string& text, ScenarioObstacle& out) {
+    istringstream is(text);
+    ScenarioObstacle o;
+    if (!(is >> o.x >> o.y >> o.z >> o.radius) || o.radius <= 0) return false;
+    is >> ws;
+    if (!is.eof()) return false;
+    out = o;
+    return true;
+}
+
+template <class T>
+bool Parse(const string& text, T& out) {
+    istringstream is(text);
+    T value;
+    if (!(is >> value)) return false;
+    is >> ws;
+    if (!is.eof()) return false;
+    out = value;
+    return true;
+}
+
+}
+
+bool Scenario::Set(const string& key, const string& value) {
+    if (key == "num_drones")        return Parse(value, num_drones) && num_drones >= 2;
+    if (key == "slot_duration")     return Parse(value, slot_duration) && slot_duration > 0;
+    if (key == "sim_time")          return Parse(value, sim_time);
+    if (key == "time_of_malicious") return Parse(value, time_of_malicious);
+    if (key == "malicious_id")      return Parse(value, malicious_id);
+    if (key == "master_anchor_id")  return Parse(value, master_anchor_id);
+    if (key == "packet_loss_rate")  return Parse(value, packet_loss_rate);
+    if (key == "environment")       { environment = value; return !value.empty(); }
+    if (key == "formation") {
+        FormationType type;
+        if (!ParseFormation(value, type)) return false;
+        formation = value;
+        return true;
+    }
+    if (key == "uwb_range")         return Parse(value, uwb_range) && uwb_range >= 0;
+    if (key == "max_neighbors")     return Parse(value, max_neighbors) && max_neighbors >= 0;
+    if (key == "innovation_gate")   return Parse(value, innovation_gate) && innovation_gate >= 0;
+    if (key == "filter_init") {
+        if (value != "gps" && value != "multilateration") return false;
+        filter_init = value;
+        return true;
+    }
+    if (key == "tdma_mode") {
+        if (value != "round_robin" && value != "spatial_reuse" && value != "adaptive") return false;
+        tdma_mode = value;
+        return true;
+    }
+    if (key == "clock_sync") {
+        if (value != "master" && value != "filter") return false;
+        clock_sync = value;
+        return true;
+    }
+    if (key == "clock_skew_ppm")    return Parse(value, clock_skew_ppm) && clock_skew_ppm >= 0;
+    if (key == "obstacle") {
+        ScenarioObstacle o;
+        if (!ParseObstacle(value, o)) return false;
+        obstacles.push_back(o);
+        return true;
+    }
+    if (key == "obstacle_file")     return LoadObstacleFile(value);
+    if (key == "seed")              return Parse(value, seed);
+    return false;
+}
+
+bool Scenario::LoadFile(const string& path, string& error) {
+    ifstream in(path);
+    if (!in.is_open()) {
+        error = "impossibile aprire " + path;
+        return false;
+    }
+    string line;
+    int line_no = 0;
+    while (getline(in, line)) {
+        ++line_no;
+        size_t hash = line.find('#');
+        if (hash != string::npos) line = line.substr(0, hash);
+        line = Trim(line);
+        if (line.empty()) continue;
+
+        size_t eq = line.find('=');
+        string key = Trim(line.substr(0, eq));
+        string value = eq == string::npos ? "" : Trim(line.substr(eq + 1));
+        if (eq == string::npos || !Set(key, value)) {
+            error = path + ":" + to_string(line_no) + ": voce non valida '" + line + "'";
+            return false;
+        }
+    }
+    if (!Validate(error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+bool Scenario::Validate(string& error) const {
+    if (malicious_id < 0 || malicious_id >= num_drones) {
+        error = "malicious_id = " + to_string(malicious_id) + " fuori da 0.." + to_string(num_drones - 1);
+        return false;
+    }
+    if (master_anchor_id < 0 || master_anchor_id >= num_drones) {
+        error = "master_anchor_id = " + to_string(master_anchor_id) + " fuori da 0.." + to_string(num_drones - 1);
+        return false;
+    }
+    return true;
+}
+
+bool Scenario::LoadObstacleFile(const string& path) {
+    ifstream in(path);
+    if (!in.is_open()) return false;
+    string line;
+    while (getline(in, line)) {
+        size_t hash = line.find('#');
+        if (hash != string::npos) line = line.substr(0, hash);
+        line = Trim(line);
+        if (line.empty()) continue;
+        ScenarioObstacle o;
+        if (!ParseObstacle(line, o)) return false;
+        obstacles.push_back(o);
+    }
+    return true;
+}
+
+uint32_t DeriveSeed(uint64_t seed, uint32_t stream) {
+    seed_seq seq{(uint32_t)seed, (uint32_t)(seed >> 32), stream};
+    uint32_t out;
+    seq.generate(&out, &out + 1);
+    return out;
+}
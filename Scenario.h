@@ -0,0 +1,78 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Parametri di una simulazione. I valori di default sono quelli storici di tdoa_main.
+ *
+ * Un file di scenario e' una lista di righe "chiave = valore" (commenti con '#'),
+ * con le stesse chiavi dei campi qui sotto, ad esempio:
+ *
+ *     num_drones = 6
+ *     sim_time = 300
+ *     time_of_malicious = 200
+ *     packet_loss_rate = 0.10
+ *     environment = outdoor
+ *     formation = octahedron
+ *     obstacle = 150 0 50 12      # sfera x y z raggio, chiave ripetibile
+ *     obstacle_file = city.obs    # una sfera "x y z raggio" per riga
+ *     innovation_gate = 3         # scarta le pseudorange oltre 3 sigma dalla predizione EKF
+ *     filter_init = multilateration
+ *     tdma_mode = spatial_reuse   # piu' trasmettitori per slot (serve uwb_range o max_neighbors)
+ *     clock_sync = filter         # offset + skew stimati da ogni messaggio, niente slot di sola sincronizzazione
+ *     clock_skew_ppm = 20         # skew dei clock estratto in [-20, 20] ppm per drone
+ *
+ * malicious_id e master_anchor_id devono indicare droni esistenti (0 .. num_drones-1): lo
+ * controlla Validate, chiamato da LoadFile e dai programmi prima di costruire la run.
+ * Il target della formazione e' sempre il drone 0, con deriva del clock fissa di 10000 ns
+ * (SwarmSimulation::TARGET_CLOCK_DRIFT_NS): non e' un parametro dello scenario.
+ */
+struct ScenarioObstacle {
+    double x, y, z, radius;
+};
+
+struct Scenario {
+    int num_drones = 6;
+    double slot_duration = 0.005;
+    double sim_time = 300.0;
+    double time_of_malicious = 200.0;
+    int malicious_id = 0;
+    int master_anchor_id = 1;
+    double packet_loss_rate = 0.10;
+    std::string environment = "outdoor";
+    std::string formation = "octahedron";   // octahedron | atomic_shell | circular_patrol
+    double uwb_range = 0.0;   // portata UWB in metri, 0 = illimitata
+    int max_neighbors = 0;    // ricevitori per slot (i piu' vicini), 0 = tutti quelli in portata
+    double innovation_gate = 0.0;   // gate degli update EKF in deviazioni standard (es. 3), 0 = nessuno
+    std::string filter_init = "gps";  // gps (GPS dichiarato) | multilateration (fix TDoA dello slot)
+    std::string tdma_mode = "round_robin";  // round_robin | spatial_reuse (gruppi non interferenti) | adaptive (slot dalle statistiche EKF)
+    std::string clock_sync = "master";   // master (slot del Master Anchor, solo offset) | filter (ClockFilter su ogni link)
+    double clock_skew_ppm = 0.0;         // skew massimo dei clock fisici, 0 = clock a offset costante
+    std::vector<ScenarioObstacle> obstacles;
+    uint64_t seed = 0;   // 0 = scelto a caso all'avvio
+
+    // Aggiorna i campi presenti nel file; ritorna false (con messaggio in error) se il file
+    // non si apre o contiene chiavi/valori non validi
+    bool LoadFile(const std::string& path, std::string& error);
+    // Controlli che dipendono da piu' chiavi (es. id dei droni rispetto a num_drones)
+    bool Validate(std::string& error) const;
+    bool Set(const std::string& key, const std::string& value);
+    bool LoadObstacleFile(const std::string& path);
+};
+
+// Sotto-flussi casuali di una run: tipo + indice (es. STREAM_DRONE + id)
+enum SeedStream : uint32_t {
+    STREAM_DRONE       = 0x10000000,
+    STREAM_CHANNEL     = 0x20000000,
+    STREAM_PACKET_LOSS = 0x30000000,
+    STREAM_CLOCK       = 0x40000000,
+    STREAM_CLOCK_SKEW  = 0x50000000
+};
+
+// Seme del sotto-flusso 'stream' derivato dal seme della run
+uint32_t DeriveSeed(uint64_t seed, uint32_t stream);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+
+/**
+ * Orologio e coda eventi su cui gira la logica di localizzazione e sicurezza.
+ *
+ * Drone, TDMAScheduler e SwarmSimulation conoscono solo questa interfaccia: EventLoop e'
+ * l'implementazione interna (nessuna dipendenza, un'istanza per run, utilizzabile da piu'
+ * thread in parallelo), Ns3Clock la adatta al Simulator di ns-3.
+ *
+ * Il tempo e' in picosecondi interi come in ns-3, cosi' i due backend producono gli stessi istanti.
+ */
+class SimClock {
+public:
+    virtual ~SimClock() {}
+
+    virtual int64_t NowPicoSeconds() const = 0;
+    double Now() const { return NowPicoSeconds() / 1e12; }
+
+    // Esegue fn dopo delay_s secondi di simulazione
+    virtual void Schedule(double delay_s, std::function<void()> fn) = 0;
+
+    // Esegue gli eventi fino a stop_time_s; come Simulator::Stop di ns-3, gli eventi allo
+    // stesso istante dello stop ma pianificati dopo la chiamata non vengono eseguiti
+    virtual void Run(double stop_time_s) = 0;
+
+    static int64_t ToPicoSeconds(double seconds) { return (int64_t)std::llround(seconds * 1e12); }
+};
+
+#endif
@@ -1,46 +1,51 @@
 #ifndef SIMULATION_LOGGER_H
 #define SIMULATION_LOGGER_H
 
-#include "ns3/core-module.h"
 #include "Drone.h"
+#include "TelemetryWriter.h"
+#include <memory>
 #include <vector>
-#include <fstream>
 #include <Eigen/Dense>
 
-using namespace ns3;
-
 class SimulationLogger {
 public:
-    SimulationLogger(std::vector<Ptr<Drone>>& swarm) : m_swarm(swarm) {}
+    SimulationLogger(std::vector<std::unique_ptr<Drone>>& swarm, TelemetrySink& sink) : m_swarm(swarm), m_sink(sink) {}
 
     void LogObservation(
-        double time, 
-        int sender_id, 
+        double time,
+        int sender_id,
         int observer_id,
-        Eigen::Vector3d claimed_gps, 
-               Eigen::Vector3d recovered_pos,
-               std::ofstream& csv
+        Eigen::Vector3d claimed_gps,
+               Eigen::Vector3d recovered_pos
     ) {
-        
-        Ptr<Drone> observer = m_swarm[observer_id];
-        Ptr<Drone> sender = m_swarm[sender_id];
+
+        Drone* observer = m_swarm[observer_id].get();
+        Drone* sender = m_swarm[sender_id].get();
 
         Eigen::Vector3d estimated = observer->GetEstimatedPositionOf(sender_id);
         bool alarm = observer->IsAlarmActiveFor(sender_id);
         Eigen::Vector3d truth = sender->GetTruePosition();
-        double discrepancy = (estimated - claimed_gps).norm();
-        double estimation_error = (estimated - truth).norm();
-
-        csv << time << "," << sender_id << "," << observer_id << ","
-        << estimated.x() << "," << estimated.y() << "," << estimated.z() << ","
-        << claimed_gps.x() << "," << claimed_gps.y() << "," << claimed_gps.z() << ","
-        << truth.x() << "," << truth.y() << "," << truth.z() << ","
-        << discrepancy << "," << estimation_error << "," << alarm << ","
-        << recovered_pos.x() << "," << recovered_pos.y() << "," << recovered_pos.z() << "\n";
+
+        ObservationRecord rec;
+        rec.time = time;
+        rec.sender_id = sender_id;
+        rec.observer_id = observer_id;
+        for (int k = 0; k < 3; ++k) {
+            rec.est[k] = estimated(k);
+            rec.claim[k] = claimed_gps(k);
+            rec.truth[k] = truth(k);
+            rec.rec[k] = recovered_pos(k);
+        }
+        rec.discrepancy = (estimated - claimed_gps).norm();
+        rec.estimation_error = (estimated - truth).norm();
+        rec.alarm = alarm ? 1 : 0;
+
+        m_sink.Write(rec);
     }
 
 private:
-    std::vector<Ptr<Drone>>& m_swarm;
+    std::vector<std::unique_ptr<Drone>>& m_swarm;
+    TelemetrySink& m_sink;
 };
 
 #endif
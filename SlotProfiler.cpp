@@ -0,0 +1,148 @@
+#include "SlotProfiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace std;
+
+namespace {
+const int SUB = 1 << LatencyHistogram::SUB_BITS;
+const int HALF = SUB / 2;
+}
+
+LatencyHistogram::LatencyHistogram() : m_count(0), m_min(UINT64_MAX), m_max(0), m_sum(0.0) {}
+
+int LatencyHistogram::NumBuckets() {
+    return SUB + (MAX_BITS - SUB_BITS) * HALF;
+}
+
+// Sotto SUB un bucket per valore; sopra, ogni ottava [2^k, 2^(k+1)) ha HALF bucket larghi 2^(k - SUB_BITS + 1)
+int LatencyHistogram::BucketIndex(uint64_t value) {
+    if (value < (uint64_t)SUB) return (int)value;
+    const uint64_t max_value = (1ull << MAX_BITS) - 1;
+    if (value > max_value) value = max_value;
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - SUB_BITS + 1;
+    int mantissa = (int)(value >> shift);
+    return SUB + (shift - 1) * HALF + (mantissa - HALF);
+}
+
+uint64_t LatencyHistogram::BucketHighest(int index) {
+    if (index < SUB) return (uint64_t)index;
+    int k = index - SUB;
+    int shift = k / HALF + 1;
+    uint64_t mantissa = HALF + k % HALF;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value_ns) {
+    if (m_counts.empty()) m_counts.assign(NumBuckets(), 0);
+    m_counts[BucketIndex(value_ns)]++;
+    m_count++;
+    m_min = std::min(m_min, value_ns);
+    m_max = std::max(m_max, value_ns);
+    m_sum += (double)value_ns;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    if (other.m_count == 0) return;
+    if (m_counts.empty()) m_counts.assign(NumBuckets(), 0);
+    for (size_t i = 0; i < m_counts.size(); ++i) m_counts[i] += other.m_counts[i];
+    m_count += other.m_count;
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+    m_sum += other.m_sum;
+}
+
+void LatencyHistogram::Clear() {
+    m_counts.clear();
+    m_count = 0;
+    m_min = UINT64_MAX;
+    m_max = 0;
+    m_sum = 0.0;
+}
+
+uint64_t LatencyHistogram::Percentile(double p) const {
+    if (m_count == 0) return 0;
+    uint64_t target = (uint64_t)std::ceil(std::min(100.0, std::max(0.0, p)) / 100.0 * m_count);
+    target = std::max<uint64_t>(target, 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < m_counts.size(); ++i) {
+        seen += m_counts[i];
+        if (seen >= target) return std::min(BucketHighest((int)i), m_max);
+    }
+    return m_max;
+}
+
+SlotProfiler::SlotProfiler() : m_budget_ns(0) {
+    std::fill(m_counters, m_counters + NUM_COUNTERS, 0);
+}
+
+bool SlotProfiler::Enabled() {
+#ifdef TDOA_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char* SlotProfiler::PhaseName(Phase phase) {
+    switch (phase) {
+        case PHASE_SLOT:       return "slot";
+        case PHASE_CHANNEL:    return "channel";
+        case PHASE_CLOCK_SYNC: return "clock_sync";
+        case PHASE_EKF_UPDATE: return "ekf_update";
+        case PHASE_TALLY:      return "tally";
+        case PHASE_LOGGING:    return "logging";
+        default:               return "?";
+    }
+}
+
+const char* SlotProfiler::CounterName(Counter counter) {
+    switch (counter) {
+        case COUNT_LINKS:             return "links";
+        case COUNT_MEASUREMENTS:      return "measurements";
+        case COUNT_CLOCK_CORRECTIONS: return "clock_corrections";
+        case COUNT_CONSENSUS_ALARMS:  return "consensus_alarms";
+        case COUNT_LOG_RECORDS:       return "log_records";
+        case COUNT_OVER_BUDGET:       return "slots_over_budget";
+        default:                      return "?";
+    }
+}
+
+void SlotProfiler::Record(Phase phase, uint64_t ns) {
+    m_phases[phase].Record(ns);
+    if (phase == PHASE_SLOT && m_budget_ns > 0 && ns > m_budget_ns) m_counters[COUNT_OVER_BUDGET]++;
+}
+
+void SlotProfiler::Merge(const SlotProfiler& other) {
+    for (int p = 0; p < NUM_PHASES; ++p) m_phases[p].Merge(other.m_phases[p]);
+    for (int c = 0; c < NUM_COUNTERS; ++c) m_counters[c] += other.m_counters[c];
+}
+
+void SlotProfiler::Print(std::ostream& os) const {
+    char line[256];
+    snprintf(line, sizeof(line), "%-12s %10s %10s %10s %10s %10s %10s %10s\n",
+             "phase [us]", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+    os << line;
+    for (int p = 0; p < NUM_PHASES; ++p) {
+        const LatencyHistogram& h = m_phases[p];
+        if (h.Count() == 0) continue;
+        snprintf(line, sizeof(line), "%-12s %10llu %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+                 PhaseName((Phase)p), (unsigned long long)h.Count(), h.Mean() / 1e3, h.Percentile(50) / 1e3,
+                 h.Percentile(90) / 1e3, h.Percentile(99) / 1e3, h.Percentile(99.9) / 1e3, h.Max() / 1e3);
+        os << line;
+    }
+    for (int c = 0; c < NUM_COUNTERS; ++c) os << CounterName((Counter)c) << " = " << m_counters[c] << "\n";
+
+    const LatencyHistogram& slot = m_phases[PHASE_SLOT];
+    if (m_budget_ns > 0 && slot.Count() > 0) {
+        // Margine: di quanto puo' essere piu' lenta la CPU di bordo restando nel budget al p99 / nel caso peggiore
+        double p99 = (double)std::max<uint64_t>(slot.Percentile(99), 1);
+        double worst = (double)std::max<uint64_t>(slot.Max(), 1);
+        snprintf(line, sizeof(line), "slot budget %.0f us: p99 headroom %.1fx, worst-case headroom %.1fx, %llu/%llu slots over budget\n",
+                 m_budget_ns / 1e3, m_budget_ns / p99, m_budget_ns / worst,
+                 (unsigned long long)m_counters[COUNT_OVER_BUDGET], (unsigned long long)slot.Count());
+        os << line;
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef SLOT_PROFILER_H
+#define SLOT_PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/**
+ * Istogramma di latenze in stile HDR: bucket log-lineari con 2^SUB_BITS sotto-bucket per
+ * ottava, quindi errore relativo sotto l'1% su tutto l'intervallo (da 1 ns a ~18 minuti)
+ * con memoria fissa e Record in O(1). I bucket vengono allocati al primo Record.
+ */
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 8;
+    static const int MAX_BITS = 40;   // valori oltre 2^40 ns vanno nell'ultimo bucket
+
+    LatencyHistogram();
+
+    void Record(uint64_t value_ns);
+    void Merge(const LatencyHistogram& other);
+    void Clear();
+
+    uint64_t Count() const { return m_count; }
+    uint64_t Min() const { return m_count ? m_min : 0; }
+    uint64_t Max() const { return m_max; }
+    double Mean() const { return m_count ? m_sum / m_count : 0.0; }
+    // Valore massimo equivalente del bucket che contiene il percentile p (0..100)
+    uint64_t Percentile(double p) const;
+
+private:
+    static int BucketIndex(uint64_t value);
+    static uint64_t BucketHighest(int index);
+    static int NumBuckets();
+
+    std::vector<uint64_t> m_counts;
+    uint64_t m_count;
+    uint64_t m_min, m_max;
+    double m_sum;
+};
+
+/**
+ * Tempi per fase di ogni slot TDMA e contatori, per verificare il budget di slot_duration.
+ *
+ * Le fasi si misurano con TDOA_PROFILE_SCOPE e i contatori con TDOA_PROFILE_COUNT: senza
+ * -DTDOA_PROFILE (opzione CMake TDOA_PROFILE) le macro non generano codice e lo scheduler
+ * non legge mai l'orologio. Le misure sono tempo di parete dal thread dello scheduler: con
+ * il WorkerPool una fase parallela conta per la sua durata complessiva.
+ */
+class SlotProfiler {
+public:
+    enum Phase {
+        PHASE_SLOT,          // ExecuteSlot completo
+        PHASE_CHANNEL,       // canale + misure di ToA dei ricevitori
+        PHASE_CLOCK_SYNC,    // slot del Master Anchor: canale + correzione degli offset
+        PHASE_EKF_UPDATE,    // maschere di ricezione + aggiornamento dei filtri
+        PHASE_TALLY,         // voto SwarmRaft e recupero della posizione
+        PHASE_LOGGING,       // record di telemetria dello slot
+        NUM_PHASES
+    };
+    enum Counter {
+        COUNT_LINKS,
+        COUNT_MEASUREMENTS,
+        COUNT_CLOCK_CORRECTIONS,
+        COUNT_CONSENSUS_ALARMS,
+        COUNT_LOG_RECORDS,
+        COUNT_OVER_BUDGET,   // slot piu' lunghi di slot_duration
+        NUM_COUNTERS
+    };
+
+    class ScopedTimer {
+    public:
+        ScopedTimer(SlotProfiler& profiler, Phase phase)
+            : m_profiler(profiler), m_phase(phase), m_start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start);
+            m_profiler.Record(m_phase, (uint64_t)ns.count());
+        }
+    private:
+        SlotProfiler& m_profiler;
+        Phase m_phase;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    SlotProfiler();
+
+    static bool Enabled();
+    static const char* PhaseName(Phase phase);
+    static const char* CounterName(Counter counter);
+
+    void SetBudget(double slot_duration_s) { m_budget_ns = (uint64_t)(slot_duration_s * 1e9); }
+    uint64_t GetBudgetNs() const { return m_budget_ns; }
+
+    void Record(Phase phase, uint64_t ns);
+    void Add(Counter counter, uint64_t n) { m_counters[counter] += n; }
+    void Merge(const SlotProfiler& other);
+
+    const LatencyHistogram& GetHistogram(Phase phase) const { return m_phases[phase]; }
+    uint64_t GetCounter(Counter counter) const { return m_counters[counter]; }
+
+    // Tabella per fase (conteggio, media, percentili, massimo in us), contatori e margine sul budget
+    void Print(std::ostream& os) const;
+
+private:
+    LatencyHistogram m_phases[NUM_PHASES];
+    uint64_t m_counters[NUM_COUNTERS];
+    uint64_t m_budget_ns;
+};
+
+#define TDOA_PROFILE_CONCAT_(a, b) a##b
+#define TDOA_PROFILE_CONCAT(a, b) TDOA_PROFILE_CONCAT_(a, b)
+
+#ifdef TDOA_PROFILE
+#define TDOA_PROFILE_SCOPE(profiler, phase) \
+    SlotProfiler::ScopedTimer TDOA_PROFILE_CONCAT(tdoa_profile_timer_, __LINE__)((profiler), (phase))
+#define TDOA_PROFILE_COUNT(profiler, counter, n) (profiler).Add((counter), (n))
+#else
+#define TDOA_PROFILE_SCOPE(profiler, phase) ((void)0)
+#define TDOA_PROFILE_COUNT(profiler, counter, n) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,135 @@
+#include "SlotRecord.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+const char MAGIC[8] = {'T', 'D', 'O', 'A', 'S', 'L', 'T', '\0'};
+const size_t HEADER_BYTES = 16;
+const size_t RECORD_BYTES = 2 * sizeof(uint32_t) + 5 * sizeof(double);
+const size_t MEASUREMENT_BYTES = 2 * sizeof(uint32_t) + 4 * sizeof(double);
+
+template <class T>
+void Put(ofstream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+}
+
+SlotRecordWriter::SlotRecordWriter(const string& path, uint32_t num_drones)
+    : m_out(path, ios::binary | ios::trunc)
+{
+    if (!m_out.is_open()) return;
+    m_out.write(MAGIC, sizeof(MAGIC));
+    Put<uint32_t>(m_out, VERSION);
+    Put<uint32_t>(m_out, num_drones);
+}
+
+void SlotRecordWriter::Write(const SlotRecord& rec) {
+    Write(rec.sender_id, rec.time, rec.tx_timestamp, rec.claimed_gps, rec.measurements);
+}
+
+void SlotRecordWriter::Write(uint32_t sender_id, double time, double tx_timestamp, const Eigen::Vector3d& claimed_gps,
+                             const vector<RangingMeasurement>& measurements) {
+    Put<uint32_t>(m_out, sender_id);
+    Put<uint32_t>(m_out, (uint32_t)measurements.size());
+    Put<double>(m_out, time);
+    Put<double>(m_out, tx_timestamp);
+    for (int a = 0; a < 3; ++a) Put<double>(m_out, claimed_gps(a));
+    for (const auto& m : measurements) {
+        Put<uint32_t>(m_out, m.anchor_id);
+        Put<uint32_t>(m_out, m.is_los ? 1u : 0u);
+        for (int a = 0; a < 3; ++a) Put<double>(m_out, m.anchor_pos(a));
+        Put<double>(m_out, m.toa_seconds);
+    }
+}
+
+SlotRecordReader::SlotRecordReader(const string& path)
+    : m_in(path, ios::binary), m_buf(BUFFER_BYTES), m_pos(0), m_end(0), m_ok(false), m_num_drones(0)
+{
+    if (!m_in.is_open()) {
+        m_error = "cannot open " + path;
+        return;
+    }
+    if (!Fill(HEADER_BYTES) || memcmp(&m_buf[m_pos], MAGIC, sizeof(MAGIC)) != 0) {
+        m_error = path + ": not a slot record file";
+        return;
+    }
+    m_pos += sizeof(MAGIC);
+    uint32_t version = Take<uint32_t>();
+    m_num_drones = Take<uint32_t>();
+    if (version != SlotRecordWriter::VERSION) {
+        m_error = path + ": unsupported version " + to_string(version);
+        return;
+    }
+    if (m_num_drones < 2 || m_num_drones > MAX_DRONES) {
+        m_error = path + ": invalid slot record file (num_drones " + to_string(m_num_drones) + ")";
+        return;
+    }
+    m_ok = true;
+}
+
+// Garantisce almeno 'bytes' byte non letti nel buffer; false se il file finisce prima
+bool SlotRecordReader::Fill(size_t bytes) {
+    if (m_end - m_pos >= bytes) return true;
+    memmove(m_buf.data(), m_buf.data() + m_pos, m_end - m_pos);
+    m_end -= m_pos;
+    m_pos = 0;
+    if (m_buf.size() < bytes) m_buf.resize(bytes);
+    while (m_end < bytes && m_in) {
+        m_in.read(m_buf.data() + m_end, m_buf.size() - m_end);
+        m_end += (size_t)m_in.gcount();
+    }
+    return m_end >= bytes;
+}
+
+template <class T>
+T SlotRecordReader::Take() {
+    T value;
+    memcpy(&value, &m_buf[m_pos], sizeof(T));
+    m_pos += sizeof(T);
+    return value;
+}
+
+bool SlotRecordReader::Next(SlotRecord& rec) {
+    if (!m_ok) return false;
+    if (!Fill(RECORD_BYTES)) {
+        if (m_end != m_pos) m_error = "truncated slot record";
+        m_ok = false;
+        return false;
+    }
+    rec.sender_id = Take<uint32_t>();
+    uint32_t n = Take<uint32_t>();
+    rec.time = Take<double>();
+    rec.tx_timestamp = Take<double>();
+    for (int a = 0; a < 3; ++a) rec.claimed_gps(a) = Take<double>();
+
+    // Un ricevitore da' al massimo una misura per slot: oltre e' un file corrotto
+    if (rec.sender_id >= m_num_drones || n > m_num_drones) {
+        m_error = "invalid slot record (sender " + to_string(rec.sender_id) + ", " + to_string(n) + " measurements)";
+        m_ok = false;
+        return false;
+    }
+    if (!Fill((size_t)n * MEASUREMENT_BYTES)) {
+        m_error = "truncated slot record";
+        m_ok = false;
+        return false;
+    }
+    rec.measurements.resize(n);
+    for (uint32_t k = 0; k < n; ++k) {
+        RangingMeasurement& m = rec.measurements[k];
+        m.target_id = rec.sender_id;
+        m.anchor_id = Take<uint32_t>();
+        m.is_los = Take<uint32_t>() != 0;
+        for (int a = 0; a < 3; ++a) m.anchor_pos(a) = Take<double>();
+        m.toa_seconds = Take<double>();
+        if (m.anchor_id >= m_num_drones) {
+            m_error = "invalid anchor id " + to_string(m.anchor_id);
+            m_ok = false;
+            return false;
+        }
+    }
+    return true;
+}
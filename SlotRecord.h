@@ -0,0 +1,78 @@
+#ifndef SLOT_RECORD_H
+#define SLOT_RECORD_H
+
+#include "UWBMessage.h"
+#include <Eigen/Dense>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * Uno slot TDMA come lo vede lo sciame: chi ha trasmesso, quando, la posizione GPS che ha
+ * dichiarato e le misure di ToA raccolte dai ricevitori. E' l'ingresso del rilevatore,
+ * registrato dal simulatore (--recordSlots) o convertito dai log di volo.
+ */
+struct SlotRecord {
+    uint32_t sender_id;
+    double time;              // istante di ricezione dello slot [s]
+    double tx_timestamp;      // timestamp di trasmissione dichiarato dal sender [s]
+    Eigen::Vector3d claimed_gps;
+    std::vector<RangingMeasurement> measurements;   // target_id = sender_id
+};
+
+/**
+ * File di slot (.slots), little-endian:
+ *   char[8]  magic "TDOASLT\0"
+ *   uint32   version, num_drones
+ * poi un record per slot:
+ *   uint32   sender_id, num_measurements
+ *   double   time, tx_timestamp, claimed_gps[3]
+ *   num_measurements x { uint32 anchor_id, uint32 is_los, double anchor_pos[3], double toa }
+ */
+class SlotRecordWriter {
+public:
+    static const uint32_t VERSION = 1;
+
+    SlotRecordWriter(const std::string& path, uint32_t num_drones);
+    bool IsOpen() const { return m_out.is_open(); }
+    void Write(const SlotRecord& rec);
+    void Write(uint32_t sender_id, double time, double tx_timestamp, const Eigen::Vector3d& claimed_gps,
+               const std::vector<RangingMeasurement>& measurements);
+    void Flush() { m_out.flush(); }
+
+private:
+    std::ofstream m_out;
+};
+
+/**
+ * Lettura incrementale: il file passa da un buffer di dimensione fissa, mai caricato per
+ * intero, e Next riusa la memoria del record passato (nessuna allocazione a regime).
+ */
+class SlotRecordReader {
+public:
+    static const size_t BUFFER_BYTES = 1 << 20;
+    // Oltre questo num_drones l'header e' considerato corrotto: la banca EKF ne alloca N^2
+    static const uint32_t MAX_DRONES = 4096;
+
+    explicit SlotRecordReader(const std::string& path);
+    bool IsOpen() const { return m_ok; }
+    uint32_t GetNumDrones() const { return m_num_drones; }
+    const std::string& GetError() const { return m_error; }
+
+    // false a fine file o su errore (GetError non vuoto: file troncato o record non valido)
+    bool Next(SlotRecord& rec);
+
+private:
+    bool Fill(size_t bytes);
+    template <class T> T Take();
+
+    std::ifstream m_in;
+    std::vector<char> m_buf;
+    size_t m_pos, m_end;
+    bool m_ok;
+    uint32_t m_num_drones;
+    std::string m_error;
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include "SpatialGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace Eigen;
+using namespace std;
+
+SpatialGrid::SpatialGrid() : m_origin(0, 0, 0), m_cell(1.0) {
+    m_dims[0] = m_dims[1] = m_dims[2] = 1;
+}
+
+void SpatialGrid::Build(const vector<Vector3d>& points, double cell_size) {
+    m_points = points;
+    const int n = (int)points.size();
+
+    Vector3d lo = Vector3d::Constant(0.0), hi = Vector3d::Constant(0.0);
+    if (n > 0) {
+        lo = hi = points[0];
+        for (const auto& p : points) {
+            lo = lo.cwiseMin(p);
+            hi = hi.cwiseMax(p);
+        }
+    }
+    Vector3d extent = hi - lo;
+    double max_extent = std::max(extent.maxCoeff(), 1e-6);
+
+    m_cell = cell_size > 0 ? cell_size : max_extent / std::max(1.0, std::cbrt((double)n));
+    // Non piu' di ~8 celle per punto: con un raggio piccolo su uno sciame molto esteso
+    // la griglia diventerebbe quasi tutta vuota
+    const double max_cells = 8.0 * n + 64.0;
+    for (;;) {
+        double cells = 1.0;
+        for (int a = 0; a < 3; ++a) cells *= std::floor(extent(a) / m_cell) + 1.0;
+        if (cells <= max_cells) break;
+        m_cell *= 1.5;
+    }
+    for (int a = 0; a < 3; ++a) m_dims[a] = (int)std::floor(extent(a) / m_cell) + 1;
+    m_origin = lo;
+
+    const int num_cells = m_dims[0] * m_dims[1] * m_dims[2];
+    m_cell_start.assign(num_cells + 1, 0);
+    vector<int>& cell_of = m_cell_of;
+    cell_of.resize(n);
+    for (int i = 0; i < n; ++i) {
+        const Vector3d& p = points[i];
+        cell_of[i] = CellIndex(CellCoord(p.x(), 0), CellCoord(p.y(), 1), CellCoord(p.z(), 2));
+        m_cell_start[cell_of[i] + 1]++;
+    }
+    for (int c = 0; c < num_cells; ++c) m_cell_start[c + 1] += m_cell_start[c];
+
+    m_items.resize(n);
+    vector<int>& fill = m_fill;
+    fill.assign(m_cell_start.begin(), m_cell_start.end() - 1);
+    for (int i = 0; i < n; ++i) m_items[fill[cell_of[i]]++] = i;
+}
+
+int SpatialGrid::CellCoord(double v, int axis) const {
+    int c = (int)std::floor((v - m_origin(axis)) / m_cell);
+    return std::min(std::max(c, 0), m_dims[axis] - 1);
+}
+
+void SpatialGrid::QueryRadius(const Vector3d& center, double radius, int exclude, vector<int>& out) const {
+    out.clear();
+    const double r2 = radius * radius;
+    int lo[3], hi[3];
+    for (int a = 0; a < 3; ++a) {
+        lo[a] = CellCoord(center(a) - radius, a);
+        hi[a] = CellCoord(center(a) + radius, a);
+    }
+    for (int cz = lo[2]; cz <= hi[2]; ++cz)
+        for (int cy = lo[1]; cy <= hi[1]; ++cy)
+            for (int cx = lo[0]; cx <= hi[0]; ++cx) {
+                int c = CellIndex(cx, cy, cz);
+                for (int k = m_cell_start[c]; k < m_cell_start[c + 1]; ++k) {
+                    int id = m_items[k];
+                    if (id != exclude && (m_points[id] - center).squaredNorm() <= r2) out.push_back(id);
+                }
+            }
+    std::sort(out.begin(), out.end());
+}
+
+void SpatialGrid::QueryNearest(const Vector3d& center, int k, double max_radius, int exclude, vector<int>& out) const {
+    out.clear();
+    m_candidates.clear();
+    if (k <= 0 || m_points.empty()) return;
+
+    const double max_r2 = max_radius * max_radius;
+    const int c0[3] = {CellCoord(center.x(), 0), CellCoord(center.y(), 1), CellCoord(center.z(), 2)};
+    const int max_ring = std::max(m_dims[0], std::max(m_dims[1], m_dims[2]));
+
+    // Anelli di celle a distanza di Chebyshev crescente: dopo l'anello R ogni punto non ancora
+    // visitato dista almeno R * m_cell dal centro
+    for (int ring = 0; ring <= max_ring; ++ring) {
+        for (int dz = -ring; dz <= ring; ++dz) {
+            int cz = c0[2] + dz;
+            if (cz < 0 || cz >= m_dims[2]) continue;
+            for (int dy = -ring; dy <= ring; ++dy) {
+                int cy = c0[1] + dy;
+                if (cy < 0 || cy >= m_dims[1]) continue;
+                bool shell = std::abs(dz) == ring || std::abs(dy) == ring;
+                for (int dx = -ring; dx <= ring; dx += (shell ? 1 : 2 * std::max(ring, 1))) {
+                    int cx = c0[0] + dx;
+                    if (cx < 0 || cx >= m_dims[0]) continue;
+                    int c = CellIndex(cx, cy, cz);
+                    for (int j = m_cell_start[c]; j < m_cell_start[c + 1]; ++j) {
+                        int id = m_items[j];
+                        double d2 = (m_points[id] - center).squaredNorm();
+                        if (id != exclude && d2 <= max_r2) m_candidates.emplace_back(d2, id);
+                    }
+                }
+            }
+        }
+
+        double reach = ring * m_cell;
+        if (reach * reach > max_r2) break;
+        if ((int)m_candidates.size() >= k) {
+            std::nth_element(m_candidates.begin(), m_candidates.begin() + (k - 1), m_candidates.end());
+            if (m_candidates[k - 1].first <= reach * reach) break;
+        }
+    }
+
+    if ((int)m_candidates.size() > k) {
+        std::nth_element(m_candidates.begin(), m_candidates.begin() + (k - 1), m_candidates.end());
+        m_candidates.resize(k);
+    }
+    for (const auto& c : m_candidates) out.push_back(c.second);
+    std::sort(out.begin(), out.end());
+}
@@ -0,0 +1,48 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <Eigen/Dense>
+#include <vector>
+
+using namespace Eigen;
+using namespace std;
+
+/**
+ * Griglia uniforme sulle posizioni dei droni per la selezione dei vicini.
+ *
+ * Build ordina gli id per cella (counting sort, O(N)) e va rifatta quando le posizioni
+ * cambiano; le query visitano solo le celle che possono contenere risultati.
+ * Punti fuori dal bounding box di costruzione finiscono nelle celle di bordo, quindi
+ * le query restano corrette anche con un centro esterno alla griglia.
+ */
+class SpatialGrid {
+public:
+    SpatialGrid();
+
+    // cell_size <= 0: scelta automatica (circa un punto per cella)
+    void Build(const vector<Vector3d>& points, double cell_size);
+
+    int GetNumPoints() const { return (int)m_points.size(); }
+
+    // Id dei punti a distanza <= radius da center (escluso 'exclude'), in ordine crescente
+    void QueryRadius(const Vector3d& center, double radius, int exclude, vector<int>& out) const;
+
+    // I k punti piu' vicini a center entro max_radius (escluso 'exclude'), in ordine crescente di id.
+    // A parita' di distanza vince l'id minore.
+    void QueryNearest(const Vector3d& center, int k, double max_radius, int exclude, vector<int>& out) const;
+
+private:
+    int CellCoord(double v, int axis) const;
+    int CellIndex(int cx, int cy, int cz) const { return (cz * m_dims[1] + cy) * m_dims[0] + cx; }
+
+    vector<Vector3d> m_points;
+    Vector3d m_origin;
+    double m_cell;
+    int m_dims[3];
+    vector<int> m_cell_start;   // celle + 1: gli id della cella c sono m_items[m_cell_start[c] .. m_cell_start[c+1])
+    vector<int> m_items;
+    vector<int> m_cell_of, m_fill;   // buffer di Build, riusati tra una ricostruzione e l'altra
+    mutable vector<pair<double, int>> m_candidates;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Ring buffer lock-free a singolo produttore / singolo consumatore.
+ * La capacita' viene arrotondata alla potenza di due successiva; head e tail sono
+ * contatori monotoni, su cache line separate per non farle rimbalzare tra i core.
+ */
+template <class T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) : m_head(0), m_tail(0) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        m_buffer.resize(cap);
+        m_mask = cap - 1;
+    }
+
+    size_t Capacity() const { return m_mask + 1; }
+
+    size_t Size() const {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+    // Lato produttore
+    bool TryPush(const T& item) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) > m_mask) return false;
+        m_buffer[head & m_mask] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Lato consumatore: copia fino a max_items elementi in out, ritorna quanti
+    size_t PopBatch(T* out, size_t max_items) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t available = m_head.load(std::memory_order_acquire) - tail;
+        size_t n = available < max_items ? available : max_items;
+        for (size_t i = 0; i < n; ++i) out[i] = m_buffer[(tail + i) & m_mask];
+        m_tail.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+private:
+    std::vector<T> m_buffer;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+};
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef SWARM_CONSENSUS_H
+#define SWARM_CONSENSUS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Insieme di id di droni in un bitset impacchettato (64 id per parola), dimensionato a runtime.
+ */
+class VoteBitset {
+public:
+    VoteBitset() : m_bits(0) {}
+    explicit VoteBitset(size_t bits) { Resize(bits); }
+
+    void Resize(size_t bits) {
+        m_bits = bits;
+        m_words.assign((bits + 63) / 64, 0);
+    }
+    size_t Size() const { return m_bits; }
+
+    bool Test(size_t i) const { return (m_words[i >> 6] >> (i & 63)) & 1; }
+    void Set(size_t i) { m_words[i >> 6] |= (uint64_t)1 << (i & 63); }
+    void Reset(size_t i) { m_words[i >> 6] &= ~((uint64_t)1 << (i & 63)); }
+    void ClearAll() { for (auto& w : m_words) w = 0; }
+
+    // Tutti i bit validi a 1 (i bit oltre Size() restano a 0)
+    void SetAll() {
+        for (auto& w : m_words) w = ~(uint64_t)0;
+        if (m_bits & 63) m_words.back() = ((uint64_t)1 << (m_bits & 63)) - 1;
+    }
+
+    size_t Count() const {
+        size_t n = 0;
+        for (uint64_t w : m_words) n += __builtin_popcountll(w);
+        return n;
+    }
+
+    const std::vector<uint64_t>& Words() const { return m_words; }
+    std::vector<uint64_t>& Words() { return m_words; }
+
+private:
+    size_t m_bits;
+    std::vector<uint64_t> m_words;
+};
+
+/**
+ * Stato dei voti SwarmRaft di tutto lo sciame.
+ *
+ * Per ogni osservatore un VoteBitset degli allarmi (bit t = "il GPS dichiarato da t non
+ * torna con la mia stima") e per ogni target il numero di osservatori in allarme.
+ * SetAlarm aggiorna il contatore solo quando il flag cambia, quindi il voto complessivo
+ * su un trasmettitore si legge in O(1) senza ricostruire le maschere di tutti.
+ *
+ * SetAlarm puo' essere chiamata in parallelo per osservatori diversi (ogni bitset ha un
+ * solo scrittore, i contatori sono atomici).
+ */
+class SwarmConsensus {
+public:
+    // Allarme di consenso sul trasmettitore quando la somma dei voti scende a questa soglia
+    static const int ALARM_VOTE_SUM = -3;
+
+    SwarmConsensus() : m_num_drones(0) {}
+    explicit SwarmConsensus(int num_drones) { Resize(num_drones); }
+
+    void Resize(int num_drones) {
+        m_num_drones = num_drones;
+        m_alarms.assign(num_drones, VoteBitset(num_drones));
+        m_alarm_count.reset(new std::atomic<int32_t>[num_drones]);
+        for (int i = 0; i < num_drones; ++i) m_alarm_count[i].store(0, std::memory_order_relaxed);
+    }
+    int GetNumDrones() const { return m_num_drones; }
+
+    bool HasAlarm(int observer, int target) const { return m_alarms[observer].Test(target); }
+
+    void SetAlarm(int observer, int target, bool alarm) {
+        VoteBitset& set = m_alarms[observer];
+        if (set.Test(target) == alarm) return;
+        if (alarm) {
+            set.Set(target);
+            m_alarm_count[target].fetch_add(1, std::memory_order_relaxed);
+        } else {
+            set.Reset(target);
+            m_alarm_count[target].fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Ritira tutti gli allarmi di un osservatore: costo proporzionale alle parole e ai bit attivi
+    void ClearObserver(int observer) {
+        std::vector<uint64_t>& words = m_alarms[observer].Words();
+        for (size_t w = 0; w < words.size(); ++w) {
+            uint64_t bits = words[w];
+            while (bits) {
+                int b = __builtin_ctzll(bits);
+                m_alarm_count[w * 64 + b].fetch_sub(1, std::memory_order_relaxed);
+                bits &= bits - 1;
+            }
+            words[w] = 0;
+        }
+    }
+
+    const VoteBitset& AlarmsOf(int observer) const { return m_alarms[observer]; }
+
+    int AlarmCount(int target) const { return m_alarm_count[target].load(std::memory_order_relaxed); }
+
+    // Somma dei voti su target: +1 per ogni osservatore che si fida, -1 per ogni allarme
+    int VoteSum(int target) const {
+        int voters = m_num_drones - 1;
+        return voters - 2 * AlarmCount(target);
+    }
+
+    // Come VoteSum ma contando solo i voti degli osservatori in 'voters' (es. i vicini in portata)
+    int VoteSumAmong(int target, const std::vector<int>& voters) const {
+        int sum = 0;
+        for (int o : voters) sum += HasAlarm(o, target) ? -1 : 1;
+        return sum;
+    }
+
+    // Voti espressi da un osservatore: bit a 1 = fiducia, bit a 0 = allarme
+    void GetVotes(int observer, VoteBitset& out) const {
+        const VoteBitset& alarms = m_alarms[observer];
+        out.Resize(alarms.Size());
+        out.SetAll();
+        for (size_t w = 0; w < out.Words().size(); ++w) out.Words()[w] &= ~alarms.Words()[w];
+    }
+
+private:
+    int m_num_drones;
+    std::vector<VoteBitset> m_alarms;
+    std::unique_ptr<std::atomic<int32_t>[]> m_alarm_count;
+};
+
+#endif
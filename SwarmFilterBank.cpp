@@ -0,0 +1,388 @@
+#include "SwarmFilterBank.h"
+#include "Multilateration.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+using namespace Eigen;
+using namespace std;
+
+namespace {
+
+const double C_LIGHT = 299792458.0;
+const double MEAS_VARIANCE = 2.0;
+const double ALARM_THRESHOLD_M = 10.0;
+const int MIN_MEASUREMENTS = 4;
+// Fix di multilaterazione accettati per inizializzare un filtro, e soglia di divergenza
+// (innovazione normalizzata media y^2 / S sulle misure dello slot, 100 = 10 sigma)
+const double MAX_FIX_PDOP = 6.0;
+const double MAX_FIX_RESIDUAL_M = 5.0;
+const double DIVERGENCE_NIS = 100.0;
+
+const int S = SwarmFilterBank::STATE_DIM;
+const int B = SwarmFilterBank::LANE_BLOCK;
+
+// Diagonale di P all'inizializzazione di un filtro
+const double INIT_VARIANCE[S] = {5.0, 5.0, 5.0, 1.0, 1.0, 1.0, 500.0};
+
+// Indice nel triangolo superiore (riga per riga) dell'elemento (i, j) di P
+inline int Tri(int i, int j) {
+    if (i > j) std::swap(i, j);
+    return i * S - i * (i - 1) / 2 + (j - i);
+}
+
+// nis[j] = y0^2 / (H P0 H^T + R): innovazione normalizzata della misura rispetto alla
+// predizione della corsia j, con P0 ridotta a {x, y, z, bias}
+inline void PriorInnovation(const RangingMeasurement& meas, double tx_timestamp, const double* px0, const double* py0,
+                            const double* pz0, const double* b0, const double (*p0)[4][B], double* nis) {
+    const double z = (meas.toa_seconds - tx_timestamp) * C_LIGHT;
+    for (int j = 0; j < B; ++j) {
+        double dx = px0[j] - meas.anchor_pos.x(), dy = py0[j] - meas.anchor_pos.y(), dz = pz0[j] - meas.anchor_pos.z();
+        double geo_dist = std::sqrt(dx * dx + dy * dy + dz * dz);
+        double inv = 1.0 / (geo_dist + 1e-9);
+        double h[4] = {dx * inv, dy * inv, dz * inv, 1.0};
+        double s0 = MEAS_VARIANCE;
+        for (int a = 0; a < 4; ++a)
+            for (int c = 0; c < 4; ++c) s0 += h[a] * p0[a][c][j] * h[c];
+        double y0 = z - (geo_dist + b0[j]);
+        nis[j] = y0 * y0 / s0;
+    }
+}
+
+// Fix dalle misure ricevute dall'osservatore, se abbastanza preciso da inizializzare un filtro
+bool ObserverFix(const SwarmFilterBank::TransmitterBatch& batch, int observer, MultilaterationFix& fix) {
+    return SolveMultilateration(batch.measurements, batch.num_measurements, batch.tx_timestamp, fix,
+                                batch.keep, batch.keep_stride, observer)
+        && fix.pdop <= MAX_FIX_PDOP && fix.residual_rms <= MAX_FIX_RESIDUAL_M;
+}
+
+}
+
+SwarmFilterBank::SwarmFilterBank()
+    : m_num_drones(0), m_num_filters(0), m_gate2(std::numeric_limits<double>::infinity()),
+      m_init_mode(INIT_CLAIMED_GPS) {}
+
+SwarmFilterBank::SwarmFilterBank(int num_drones) : SwarmFilterBank() {
+    Resize(num_drones);
+}
+
+void SwarmFilterBank::Resize(int num_drones) {
+    m_num_drones = num_drones;
+    m_num_filters = (size_t)num_drones * num_drones;
+    m_state.assign((size_t)STATE_DIM * m_num_filters, 0.0);
+    m_cov.assign((size_t)COV_DIM * m_num_filters, 0.0);
+    m_last_calc_time.assign(m_num_filters, 0.0);
+    m_nis.assign(m_num_filters, 0.0);
+    m_initialized.assign(m_num_filters, 0);
+    m_gate_pass.assign(m_num_filters, 0);
+    m_consensus.Resize(num_drones);
+}
+
+void SwarmFilterBank::SetInnovationGate(double n_sigma) {
+    m_gate2 = n_sigma > 0 ? n_sigma * n_sigma : std::numeric_limits<double>::infinity();
+}
+
+void SwarmFilterBank::InitFilter(int observer, int target, const Vector3d& init_pos, double init_bias) {
+    size_t f = Index(observer, target);
+    for (int k = 0; k < STATE_DIM; ++k) X(k, f) = 0.0;
+    X(0, f) = init_pos.x();
+    X(1, f) = init_pos.y();
+    X(2, f) = init_pos.z();
+    X(6, f) = init_bias;
+
+    for (int k = 0; k < COV_DIM; ++k) P(k, f) = 0.0;
+    for (int i = 0; i < STATE_DIM; ++i) P(Tri(i, i), f) = INIT_VARIANCE[i];
+
+    m_last_calc_time[f] = 0.0;
+    m_nis[f] = 0.0;
+    m_consensus.SetAlarm(observer, target, false);
+    m_initialized[f] = 1;
+}
+
+void SwarmFilterBank::ProcessTransmitter(const TransmitterBatch& batch, int first_observer, int last_observer) {
+    const Vector3d& gps = batch.claimed_gps;
+    for (int o = first_observer; o < last_observer; ++o) {
+        if (o == batch.target || m_initialized[Index(o, batch.target)]) continue;
+        MultilaterationFix fix;
+        if (m_init_mode == INIT_MULTILATERATION && ObserverFix(batch, o, fix)) InitFilter(o, batch.target, fix.position, fix.bias);
+        else InitFilter(o, batch.target, gps);
+    }
+
+    for (int o = first_observer; o < last_observer; o += LANE_BLOCK) {
+        ProcessBlock(batch, o, std::min(LANE_BLOCK, last_observer - o));
+    }
+}
+
+void SwarmFilterBank::ProcessBlock(const TransmitterBatch& batch, int first_observer, int num_lanes) {
+    const size_t f0 = Index(first_observer, batch.target);
+    const int n_meas = batch.num_measurements;
+
+    // Maschere per corsia: 1.0 = esegui Predict/Update, 0.0 = lascia il filtro invariato
+    double upd[B], dt[B], eval_alarm[B];
+    for (int j = 0; j < B; ++j) {
+        int o = first_observer + j;
+        bool valid = j < num_lanes && o != batch.target;
+        int received = 0;
+        if (valid) {
+            if (batch.keep) {
+                for (int m = 0; m < n_meas; ++m) received += batch.keep[(size_t)m * batch.keep_stride + o];
+            } else {
+                received = n_meas;
+            }
+        }
+        bool enough = valid && received >= MIN_MEASUREMENTS;
+        dt[j] = valid ? batch.current_time - m_last_calc_time[f0 + j] : 0.0;
+        upd[j] = (enough && dt[j] > 0) ? 1.0 : 0.0;
+        eval_alarm[j] = enough ? 1.0 : 0.0;
+        dt[j] *= upd[j];
+    }
+
+    // Carica il blocco di corsie in array locali (le corsie fuori range restano neutre)
+    double x[S][B], p[COV_DIM][B];
+    for (int k = 0; k < S; ++k)
+        for (int j = 0; j < B; ++j) x[k][j] = j < num_lanes ? X(k, f0 + j) : 0.0;
+    for (int k = 0; k < COV_DIM; ++k)
+        for (int j = 0; j < B; ++j) p[k][j] = j < num_lanes ? P(k, f0 + j) : 1.0;
+
+    // --- Predict: F = [I dt*I 0; 0 I 0; 0 0 1], Q = I ---
+    for (int a = 0; a < 3; ++a) {
+        for (int j = 0; j < B; ++j) x[a][j] += dt[j] * x[3 + a][j];
+    }
+    for (int a = 0; a < 3; ++a) {
+        for (int b = a; b < 3; ++b) {
+            double* ppp = p[Tri(a, b)];
+            const double* ppv_ab = p[Tri(a, 3 + b)];
+            const double* ppv_ba = p[Tri(b, 3 + a)];
+            const double* pvv = p[Tri(3 + a, 3 + b)];
+            for (int j = 0; j < B; ++j) {
+                ppp[j] += dt[j] * (ppv_ab[j] + ppv_ba[j]) + dt[j] * dt[j] * pvv[j];
+            }
+        }
+    }
+    for (int a = 0; a < 3; ++a) {
+        for (int b = 0; b < 3; ++b) {
+            double* ppv = p[Tri(a, 3 + b)];
+            const double* pvv = p[Tri(3 + a, 3 + b)];
+            for (int j = 0; j < B; ++j) ppv[j] += dt[j] * pvv[j];
+        }
+        double* ppb = p[Tri(a, 6)];
+        const double* pvb = p[Tri(3 + a, 6)];
+        for (int j = 0; j < B; ++j) ppb[j] += dt[j] * pvb[j];
+    }
+    for (int i = 0; i < S; ++i) {
+        double* pii = p[Tri(i, i)];
+        for (int j = 0; j < B; ++j) pii[j] += upd[j];
+    }
+
+    // Punto di linearizzazione (stato predetto)
+    double px0[B], py0[B], pz0[B], b0[B];
+    for (int j = 0; j < B; ++j) {
+        px0[j] = x[0][j]; py0[j] = x[1][j]; pz0[j] = x[2][j]; b0[j] = x[6][j];
+    }
+
+    // Gate sulla predizione (x0, P0) e non sullo stato gia' aggiornato dalle misure precedenti,
+    // quindi l'ordine delle misure non conta. Se il gate lascerebbe meno di MIN_MEASUREMENTS
+    // misure l'errore e' comune a tutte (salto del bias di clock, filtro in ritardo): la corsia
+    // si aggiorna senza gate invece di restare bloccata sulla predizione
+    const int hcol[4] = {0, 1, 2, 6};
+    const bool gated = m_gate2 < std::numeric_limits<double>::infinity();
+    const bool reseed = m_init_mode == INIT_MULTILATERATION;
+    double p0[4][4][B], use_gate[B];
+    if (gated || reseed) {
+        for (int a = 0; a < 4; ++a)
+            for (int c = 0; c < 4; ++c)
+                for (int j = 0; j < B; ++j) p0[a][c][j] = p[Tri(hcol[a], hcol[c])][j];
+
+        double accepted[B] = {0.0}, nis_sum[B] = {0.0}, count[B] = {0.0};
+        for (int m = 0; m < n_meas; ++m) {
+            double nis[B];
+            PriorInnovation(batch.measurements[m], batch.tx_timestamp, px0, py0, pz0, b0, p0, nis);
+            uint8_t* pass = &m_gate_pass[(size_t)m * m_num_drones + first_observer];
+            for (int j = 0; j < B; ++j) {
+                double kept = 1.0;
+                if (batch.keep && j < num_lanes) kept = batch.keep[(size_t)m * batch.keep_stride + first_observer + j];
+                if (j < num_lanes) pass[j] = nis[j] <= m_gate2;
+                accepted[j] += kept * (nis[j] <= m_gate2 ? 1.0 : 0.0);
+                nis_sum[j] += kept * nis[j];
+                count[j] += kept;
+            }
+        }
+        for (int j = 0; j < B; ++j) use_gate[j] = accepted[j] >= MIN_MEASUREMENTS ? 1.0 : 0.0;
+
+        // Filtro divergente (tutte le misure lontane dalla predizione): si riparte dal fix di
+        // multilaterazione dello slot, senza gate per questo update
+        for (int j = 0; j < num_lanes && reseed; ++j) {
+            if (upd[j] == 0.0 || count[j] < MIN_MEASUREMENTS || nis_sum[j] <= DIVERGENCE_NIS * count[j]) continue;
+            MultilaterationFix fix;
+            if (!ObserverFix(batch, first_observer + j, fix)) continue;
+            for (int k = 0; k < S; ++k) x[k][j] = 0.0;
+            x[0][j] = px0[j] = fix.position.x();
+            x[1][j] = py0[j] = fix.position.y();
+            x[2][j] = pz0[j] = fix.position.z();
+            x[6][j] = b0[j] = fix.bias;
+            for (int k = 0; k < COV_DIM; ++k) p[k][j] = 0.0;
+            for (int i = 0; i < S; ++i) p[Tri(i, i)][j] = INIT_VARIANCE[i];
+            use_gate[j] = 0.0;
+        }
+    }
+
+    // --- Update sequenziale: una pseudorange per volta su tutte le corsie ---
+    // Con R diagonale la somma delle innovazioni sequenziali normalizzate e' l'NIS dell'update
+    // a misure impilate: lo si accumula a costo quasi nullo per SummarizeTarget
+    double nis_acc[B] = {0.0}, nis_count[B] = {0.0};
+    for (int m = 0; m < n_meas; ++m) {
+        const RangingMeasurement& meas = batch.measurements[m];
+        const double ax = meas.anchor_pos.x(), ay = meas.anchor_pos.y(), az = meas.anchor_pos.z();
+        const double z = (meas.toa_seconds - batch.tx_timestamp) * C_LIGHT;
+
+        double w[B];
+        for (int j = 0; j < B; ++j) {
+            double kept = 1.0;
+            if (batch.keep && j < num_lanes) kept = batch.keep[(size_t)m * batch.keep_stride + first_observer + j];
+            w[j] = upd[j] * kept;
+        }
+
+        double u[4][B], y[B];
+        for (int j = 0; j < B; ++j) {
+            double dx = px0[j] - ax, dy = py0[j] - ay, dz = pz0[j] - az;
+            double geo_dist = std::sqrt(dx * dx + dy * dy + dz * dz);
+            double inv = 1.0 / (geo_dist + 1e-9);
+            u[0][j] = dx * inv; u[1][j] = dy * inv; u[2][j] = dz * inv; u[3][j] = 1.0;
+            // innovazione rispetto alla linearizzazione fissa: z - h(x0) - H (x - x0)
+            y[j] = z - (geo_dist + b0[j])
+                 - (u[0][j] * (x[0][j] - px0[j]) + u[1][j] * (x[1][j] - py0[j])
+                  + u[2][j] * (x[2][j] - pz0[j]) + (x[6][j] - b0[j]));
+        }
+
+        if (gated) {
+            // esito del gate gia' calcolato sulla predizione nel primo passaggio
+            const uint8_t* pass = &m_gate_pass[(size_t)m * m_num_drones + first_observer];
+            for (int j = 0; j < num_lanes; ++j) w[j] *= 1.0 - use_gate[j] * (pass[j] ? 0.0 : 1.0);
+        }
+
+        // PH = P H^T (colonne 0,1,2 e 6 di P)
+        double ph[S][B];
+        for (int i = 0; i < S; ++i) {
+            for (int j = 0; j < B; ++j) ph[i][j] = 0.0;
+            for (int c = 0; c < 4; ++c) {
+                const double* pic = p[Tri(i, hcol[c])];
+                for (int j = 0; j < B; ++j) ph[i][j] += pic[j] * u[c][j];
+            }
+        }
+
+        double g[B];
+        for (int j = 0; j < B; ++j) {
+            double s = u[0][j] * ph[0][j] + u[1][j] * ph[1][j] + u[2][j] * ph[2][j] + ph[6][j] + MEAS_VARIANCE;
+            g[j] = w[j] / s;
+            nis_acc[j] += g[j] * y[j] * y[j];
+            nis_count[j] += w[j];
+        }
+
+        for (int i = 0; i < S; ++i) {
+            for (int j = 0; j < B; ++j) x[i][j] += g[j] * ph[i][j] * y[j];
+        }
+        for (int i = 0; i < S; ++i) {
+            for (int k = i; k < S; ++k) {
+                double* pik = p[Tri(i, k)];
+                for (int j = 0; j < B; ++j) pik[j] -= g[j] * ph[i][j] * ph[k][j];
+            }
+        }
+    }
+
+    // Scrittura del blocco e controllo di sicurezza
+    const double cx = batch.claimed_gps.x(), cy = batch.claimed_gps.y(), cz = batch.claimed_gps.z();
+    for (int j = 0; j < num_lanes; ++j) {
+        if (first_observer + j == batch.target) continue;
+        size_t f = f0 + j;
+        for (int k = 0; k < S; ++k) X(k, f) = x[k][j];
+        for (int k = 0; k < COV_DIM; ++k) P(k, f) = p[k][j];
+        if (upd[j] > 0.0) m_last_calc_time[f] = batch.current_time;
+        if (nis_count[j] > 0.0) m_nis[f] = nis_acc[j] / nis_count[j];
+
+        if (eval_alarm[j] > 0.0) {
+            double ex = x[0][j] - cx, ey = x[1][j] - cy, ez = x[2][j] - cz;
+            double error = std::sqrt(ex * ex + ey * ey + ez * ez);
+            m_consensus.SetAlarm(first_observer + j, batch.target, error > ALARM_THRESHOLD_M);
+        }
+    }
+}
+
+bool SwarmFilterBank::IsInitialized(int observer, int target) const {
+    return m_initialized[Index(observer, target)] != 0;
+}
+
+Vector3d SwarmFilterBank::GetPosition(int observer, int target) const {
+    size_t f = Index(observer, target);
+    if (!m_initialized[f]) return Vector3d(0,0,0);
+    return Vector3d(m_state[f], m_state[m_num_filters + f], m_state[2 * m_num_filters + f]);
+}
+
+Matrix<double, SwarmFilterBank::STATE_DIM, 1> SwarmFilterBank::GetState(int observer, int target) const {
+    size_t f = Index(observer, target);
+    Matrix<double, STATE_DIM, 1> s;
+    for (int k = 0; k < STATE_DIM; ++k) s(k) = m_state[(size_t)k * m_num_filters + f];
+    return s;
+}
+
+bool SwarmFilterBank::IsAlarmActive(int observer, int target) const {
+    return m_consensus.HasAlarm(observer, target);
+}
+
+SwarmFilterBank::TargetSummary SwarmFilterBank::SummarizeTarget(int target) const {
+    TargetSummary sum = {0, 0.0, 0.0, 0.0, 0.0};
+    const size_t f0 = Index(0, target);
+    auto cov = [&](int i, int j, size_t f) { return m_cov[(size_t)Tri(i, j) * m_num_filters + f]; };
+    for (int o = 0; o < m_num_drones; ++o) {
+        size_t f = f0 + o;
+        if (o == target || !m_initialized[f]) continue;
+        for (int a = 0; a < 3; ++a) {
+            sum.pos_var += cov(a, a, f);
+            sum.pos_vel_cov += cov(a, 3 + a, f);
+            sum.vel_var += cov(3 + a, 3 + a, f);
+        }
+        sum.nis += m_nis[f];
+        sum.filters++;
+    }
+    if (sum.filters > 0) {
+        sum.pos_var /= sum.filters;
+        sum.pos_vel_cov /= sum.filters;
+        sum.vel_var /= sum.filters;
+        sum.nis /= sum.filters;
+    }
+    return sum;
+}
+
+void SwarmFilterBank::ClearAlarmsOf(int observer) {
+    m_consensus.ClearObserver(observer);
+}
+
+void SwarmFilterBank::SaveState(CheckpointWriter& out) const {
+    out.Put<int32_t>(m_num_drones);
+    out.PutVector(m_state);
+    out.PutVector(m_cov);
+    out.PutVector(m_last_calc_time);
+    out.PutVector(m_nis);
+    out.PutVector(m_initialized);
+    for (int o = 0; o < m_num_drones; ++o) out.PutVector(m_consensus.AlarmsOf(o).Words());
+}
+
+bool SwarmFilterBank::LoadState(CheckpointReader& in) {
+    if (in.Get<int32_t>() != m_num_drones) return false;
+    in.GetVector(m_state, (int64_t)STATE_DIM * m_num_filters);
+    in.GetVector(m_cov, (int64_t)COV_DIM * m_num_filters);
+    in.GetVector(m_last_calc_time, m_num_filters);
+    in.GetVector(m_nis, m_num_filters);
+    in.GetVector(m_initialized, m_num_filters);
+
+    // I contatori per target si ricostruiscono dai flag
+    m_consensus.Resize(m_num_drones);
+    vector<uint64_t> words;
+    for (int o = 0; o < m_num_drones; ++o) {
+        in.GetVector(words, m_consensus.AlarmsOf(o).Words().size());
+        if (!in.Ok()) return false;
+        for (int t = 0; t < m_num_drones; ++t) {
+            if ((words[t >> 6] >> (t & 63)) & 1) m_consensus.SetAlarm(o, t, true);
+        }
+    }
+    return in.Ok();
+}
@@ -0,0 +1,116 @@
+#ifndef SWARM_FILTER_BANK_H
+#define SWARM_FILTER_BANK_H
+
+#include <Eigen/Dense>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "UWBMessage.h"
+#include "SwarmConsensus.h"
+#include "Checkpoint.h"
+
+using namespace Eigen;
+using namespace std;
+
+/**
+ * Banca di EKF TDoA di tutto lo sciame, (osservatore, target) -> filtro.
+ *
+ * I filtri sono memorizzati come Structure-of-Arrays: ogni componente dello stato
+ * [x y z vx vy vz bias] e ogni elemento del triangolo superiore di P e' un array
+ * contiguo indicizzato da target * N + osservatore. Tutti gli osservatori dello stesso
+ * trasmettitore sono quindi adiacenti in memoria e ProcessTransmitter li aggiorna
+ * insieme a blocchi di LANE_BLOCK corsie, con loop che il compilatore vettorializza.
+ *
+ * L'update e' sequenziale (una pseudorange alla volta, H linearizzata nello stato
+ * predetto): con R diagonale e' equivalente all'update a misure impilate di TDoAEKF
+ * ma non richiede l'inversione di S e si adatta alle corsie SIMD. Con SetInnovationGate
+ * ogni misura viene confrontata con la predizione del suo filtro e scartata (solo per quella
+ * corsia) se l'innovazione supera n_sigma deviazioni standard: un link NLOS non entra nello stato.
+ *
+ * Di default un filtro nuovo parte dal GPS dichiarato dal trasmettitore. Con INIT_MULTILATERATION
+ * parte invece dal fix in forma chiusa delle misure dello slot (Multilateration.h), cioe' da un
+ * valore che l'attaccante non controlla, e un filtro divergente viene reinizializzato dal fix.
+ */
+class SwarmFilterBank {
+public:
+    static const int STATE_DIM = 7;
+    static const int COV_DIM = STATE_DIM * (STATE_DIM + 1) / 2;
+    static const int LANE_BLOCK = 8;
+
+    enum InitMode { INIT_CLAIMED_GPS, INIT_MULTILATERATION };
+
+    struct TransmitterBatch {
+        int target;
+        Vector3d claimed_gps;
+        const RangingMeasurement* measurements;
+        int num_measurements;    // al massimo una per ancora, quindi <= numero di droni
+        const uint8_t* keep;     // keep[m * keep_stride + observer], nullptr = tutte ricevute
+        int keep_stride;
+        double current_time;
+        double tx_timestamp;
+    };
+
+    // Riassunto dei filtri di un target su tutti i suoi osservatori (medie sui filtri inizializzati):
+    // tracce dei blocchi posizione/posizione-velocita'/velocita' di P dopo l'ultimo update e
+    // innovazione normalizzata media per misura (circa 1 se il filtro e' consistente)
+    struct TargetSummary {
+        int filters;
+        double pos_var;
+        double pos_vel_cov;
+        double vel_var;
+        double nis;
+
+        // Traccia media della covarianza di posizione predetta dt secondi dopo l'update
+        double PredictedPositionVariance(double dt) const { return pos_var + 2.0 * dt * pos_vel_cov + dt * dt * vel_var; }
+    };
+
+    SwarmFilterBank();
+    explicit SwarmFilterBank(int num_drones);
+
+    void Resize(int num_drones);
+    int GetNumDrones() const { return m_num_drones; }
+
+    void ProcessTransmitter(const TransmitterBatch& batch, int first_observer, int last_observer);
+
+    // 0 = nessun gate (default): i risultati non cambiano
+    void SetInnovationGate(double n_sigma);
+    void SetInitMode(InitMode mode) { m_init_mode = mode; }
+
+    bool IsInitialized(int observer, int target) const;
+    Vector3d GetPosition(int observer, int target) const;
+    Matrix<double, STATE_DIM, 1> GetState(int observer, int target) const;
+    bool IsAlarmActive(int observer, int target) const;
+    // O(N) su corsie contigue: va chiamata dopo l'update del target, non a ogni slot per tutti
+    TargetSummary SummarizeTarget(int target) const;
+    void ClearAlarmsOf(int observer);
+
+    // Stati, covarianze, istanti dell'ultimo update e allarmi di tutti i filtri.
+    // LoadState fallisce (false) se il checkpoint e' di uno sciame di dimensione diversa
+    void SaveState(CheckpointWriter& out) const;
+    bool LoadState(CheckpointReader& in);
+
+    // Allarmi di sicurezza e voti, aggiornati dal kernel a ogni controllo
+    const SwarmConsensus& GetConsensus() const { return m_consensus; }
+
+private:
+    size_t Index(int observer, int target) const { return (size_t)target * m_num_drones + observer; }
+    double& X(int k, size_t f) { return m_state[(size_t)k * m_num_filters + f]; }
+    double& P(int k, size_t f) { return m_cov[(size_t)k * m_num_filters + f]; }
+
+    void InitFilter(int observer, int target, const Vector3d& init_pos, double init_bias = 0.0);
+    void ProcessBlock(const TransmitterBatch& batch, int first_observer, int num_lanes);
+
+    int m_num_drones;
+    size_t m_num_filters;
+    vector<double> m_state;          // STATE_DIM x N^2
+    vector<double> m_cov;            // COV_DIM x N^2, triangolo superiore di P
+    vector<double> m_last_calc_time; // N^2
+    vector<double> m_nis;            // N^2, y^2 / S medio per misura dell'ultimo update
+    vector<uint8_t> m_initialized;   // N^2
+    vector<uint8_t> m_gate_pass;     // N x N, esito del gate per (misura, osservatore) del trasmettitore corrente
+    double m_gate2;                  // soglia su y^2 / S, infinito senza gate
+    InitMode m_init_mode;
+    SwarmConsensus m_consensus;
+};
+
+#endif
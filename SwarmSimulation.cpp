@@ -0,0 +1,181 @@
+#include "SwarmSimulation.h"
+#include "Trajectories.h"
+#include "Checkpoint.h"
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+SwarmSimulation::SwarmSimulation(const Scenario& scenario, SimClock* clock)
+    : m_scenario(scenario), m_verbose(true), m_clock(clock), m_filter_bank(scenario.num_drones),
+      m_kinematics(scenario.num_drones), m_pool(nullptr), m_recorder(nullptr),
+      m_schedule_log(nullptr), m_metrics(nullptr)
+{
+    if (!m_clock) {
+        m_own_clock = make_unique<EventLoop>();
+        m_clock = m_own_clock.get();
+    }
+
+    m_filter_bank.SetInnovationGate(m_scenario.innovation_gate);
+    m_filter_bank.SetInitMode(m_scenario.filter_init == "multilateration" ? SwarmFilterBank::INIT_MULTILATERATION
+                                                                          : SwarmFilterBank::INIT_CLAIMED_GPS);
+    m_channel.SetEnvironment(m_scenario.environment);
+    m_channel.SetSeed(DeriveSeed(m_scenario.seed, STREAM_CHANNEL));
+    for(const auto& o : m_scenario.obstacles) m_channel.AddObstacle(Vector3d(o.x, o.y, o.z), o.radius);
+
+    for(int i = 0; i < m_scenario.num_drones; ++i) {
+        auto d = make_unique<Drone>();
+        d->SetId(i);
+        d->SetClock(m_clock);
+        d->SetFilterBank(&m_filter_bank);
+        d->SetKinematics(&m_kinematics);
+        d->SetSeed(DeriveSeed(m_scenario.seed, STREAM_DRONE + i));
+        m_swarm.push_back(std::move(d));
+    }
+
+    // Formazione scelta dallo scenario: il target (drone 0) e gli altri in un'unica tabella
+    FormationType formation = FORMATION_OCTAHEDRON;
+    ParseFormation(m_scenario.formation, formation);
+    m_kinematics.SetFormation(BuildSwarmFormation(formation, m_scenario.num_drones));
+
+    m_swarm[TARGET_ID]->SetMalicious(false);
+    m_swarm[TARGET_ID]->SetClockDrift(TARGET_CLOCK_DRIFT_NS);
+
+    std::mt19937 init_rng(DeriveSeed(m_scenario.seed, STREAM_CLOCK));
+    std::uniform_real_distribution<> drift_dist(-500.0, 500.0);
+
+    for(int i = 1; i < m_scenario.num_drones; ++i)
+    {
+        m_swarm[i]->SetMalicious(false);
+        double d = drift_dist(init_rng);
+        m_swarm[i]->SetClockDrift(d);
+    }
+
+    // Flusso a parte: senza skew le estrazioni (e i risultati) restano quelle storiche
+    if (m_scenario.clock_skew_ppm > 0) {
+        std::mt19937 skew_rng(DeriveSeed(m_scenario.seed, STREAM_CLOCK_SKEW));
+        std::uniform_real_distribution<> skew_dist(-m_scenario.clock_skew_ppm * 1e-6, m_scenario.clock_skew_ppm * 1e-6);
+        for (auto& d : m_swarm) d->SetClockSkew(skew_dist(skew_rng));
+    }
+}
+
+void SwarmSimulation::SetTelemetrySink(TelemetrySink* sink) {
+    if (sink) m_logger = make_unique<SimulationLogger>(m_swarm, *sink);
+    else m_logger.reset();
+}
+
+void SwarmSimulation::SetWorkerPool(WorkerPool* pool) { m_pool = pool; }
+
+RunStats SwarmSimulation::Run() {
+    Start();
+    RunUntil(m_scenario.sim_time);
+    return GetStats();
+}
+
+void SwarmSimulation::CreateScheduler() {
+    m_scheduler = make_unique<TDMAScheduler>(m_scenario, *m_clock, m_swarm, m_filter_bank, m_kinematics, m_channel,
+                                             m_logger.get());
+}
+
+void SwarmSimulation::Start() {
+    Drone* attacker = m_swarm[m_scenario.malicious_id].get();
+    double attack_time = m_scenario.time_of_malicious;
+    bool verbose = m_verbose;
+    MetricsAggregator* metrics = m_metrics;
+    // Dopo un LoadCheckpoint l'attacco puo' essere gia' avvenuto (stato ripristinato nel drone)
+    int64_t now_ps = m_clock->NowPicoSeconds();
+    if (attacker->IsMalicious()) {
+        if (metrics) metrics->OnAttackStart(attacker->GetAttackStartTime(), attacker->GetId());
+    } else if (SimClock::ToPicoSeconds(attack_time) >= now_ps) {
+        m_clock->Schedule(attack_time - now_ps / 1e12, [attacker, attack_time, verbose, metrics]()
+        {
+            attacker->SetMalicious(true);
+            if (metrics) metrics->OnAttackStart(attacker->GetAttackStartTime(), attacker->GetId());
+            if (verbose) {
+                std::cout << ">>> ATTACK ACTIVATED: drone GPS spoofing <" << attacker->GetId() << "> starts at t="<< attack_time <<"s <<<" << std::endl;
+            }
+        });
+    }
+
+    if (!m_scheduler) CreateScheduler();
+    m_scheduler->SetLogger(m_logger.get());
+    m_scheduler->SetWorkerPool(m_pool);
+    m_scheduler->SetSlotRecorder(m_recorder);
+    m_scheduler->SetScheduleLog(m_schedule_log);
+    m_scheduler->SetMetrics(m_metrics);
+    m_scheduler->Start();
+}
+
+void SwarmSimulation::RunUntil(double t) {
+    m_clock->Run(t);
+}
+
+static const char CHECKPOINT_MAGIC[8] = {'T', 'D', 'O', 'A', 'C', 'K', 'P', '\0'};
+static const uint32_t CHECKPOINT_VERSION = 5;
+
+bool SwarmSimulation::SaveCheckpoint(const string& path, string& error) const {
+    if (!m_scheduler) {
+        error = "checkpoint before Start()";
+        return false;
+    }
+    CheckpointWriter out;
+    for (char c : CHECKPOINT_MAGIC) out.Put<char>(c);
+    out.Put<uint32_t>(CHECKPOINT_VERSION);
+    out.Put<int32_t>(m_scenario.num_drones);
+    out.Put<double>(m_scenario.slot_duration);
+    out.PutString(m_scenario.formation);
+    out.Put<int64_t>(m_clock->NowPicoSeconds());
+
+    m_kinematics.SaveState(out);
+    for (const auto& d : m_swarm) d->SaveState(out);
+    m_filter_bank.SaveState(out);
+    m_channel.SaveState(out);
+    m_scheduler->SaveState(out);
+
+    if (!out.WriteFile(path)) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool SwarmSimulation::LoadCheckpoint(const string& path, string& error) {
+    if (!m_own_clock || m_scheduler) {
+        error = "a checkpoint can be restored only before Start() on the native event loop";
+        return false;
+    }
+    CheckpointReader in;
+    if (!in.ReadFile(path)) {
+        error = "cannot read " + path;
+        return false;
+    }
+    for (char c : CHECKPOINT_MAGIC) {
+        if (in.Get<char>() != c) {
+            error = path + ": not a checkpoint file";
+            return false;
+        }
+    }
+    if (in.Get<uint32_t>() != CHECKPOINT_VERSION) {
+        error = path + ": unsupported checkpoint version";
+        return false;
+    }
+    if (in.Get<int32_t>() != m_scenario.num_drones || in.Get<double>() != m_scenario.slot_duration ||
+        in.GetString() != m_scenario.formation) {
+        error = path + ": checkpoint of a different swarm (num_drones, slot_duration or formation)";
+        return false;
+    }
+    int64_t now_ps = in.Get<int64_t>();
+
+    // Lo scheduler va creato prima di ripristinare il canale: il costruttore riassegna i semi dei ricevitori
+    CreateScheduler();
+    bool ok = in.Ok() && m_kinematics.LoadState(in);
+    for (size_t i = 0; ok && i < m_swarm.size(); ++i) ok = m_swarm[i]->LoadState(in);
+    ok = ok && m_filter_bank.LoadState(in) && m_channel.LoadState(in) && m_scheduler->LoadState(in) && in.AtEnd();
+    if (!ok) {
+        m_scheduler.reset();
+        error = path + ": truncated or corrupted checkpoint";
+        return false;
+    }
+    m_own_clock->Reset(now_ps);
+    return true;
+}
@@ -0,0 +1,81 @@
+#ifndef SWARM_SIMULATION_H
+#define SWARM_SIMULATION_H
+
+#include "Drone.h"
+#include "UWBChannel.h"
+#include "SwarmFilterBank.h"
+#include "SimulationLogger.h"
+#include "TDMAScheduler.h"
+#include "KinematicsEngine.h"
+#include "Scenario.h"
+#include "RunStats.h"
+#include "MetricsAggregator.h"
+#include "SimClock.h"
+#include "EventLoop.h"
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Una run completa: canale, sciame, banca EKF e scheduler TDMA costruiti da uno Scenario.
+ * Tutta la casualita' deriva da scenario.seed, quindi la stessa coppia (scenario, seed)
+ * riproduce la stessa run. Run() esegue gli eventi sul SimClock e restituisce gli indicatori:
+ * senza un clock esplicito la run usa un EventLoop proprio e non dipende da ns-3.
+ */
+class SwarmSimulation {
+public:
+    // Target della formazione: sempre il drone 0, con una deriva del clock fissa (ns)
+    static const int TARGET_ID = 0;
+    static constexpr double TARGET_CLOCK_DRIFT_NS = 10000.0;
+
+    explicit SwarmSimulation(const Scenario& scenario, SimClock* clock = nullptr);
+
+    void SetTelemetrySink(TelemetrySink* sink);
+    void SetWorkerPool(WorkerPool* pool);
+    void SetSlotRecorder(SlotRecordWriter* recorder) { m_recorder = recorder; }
+    // Decisioni dello scheduler con tdma_mode = adaptive, in CSV
+    void SetScheduleLog(ostream* out) { m_schedule_log = out; }
+    // Indicatori in streaming (osservazioni, decisioni, latenza dal SetMalicious), anche senza telemetria
+    void SetMetrics(MetricsAggregator* metrics) { m_metrics = metrics; }
+    void SetVerbose(bool verbose) { m_verbose = verbose; }
+
+    // Run() = Start() + RunUntil(sim_time). Con l'EventLoop RunUntil si puo' richiamare con
+    // istanti crescenti per far avanzare la run a tratti: gli eventi rimandati da uno stop
+    // vengono eseguiti dalla chiamata successiva, quindi la sequenza di slot non cambia
+    RunStats Run();
+    void Start();
+    void RunUntil(double t);
+    const RunStats& GetStats() const { return m_scheduler->GetStats(); }
+    const SlotProfiler& GetProfiler() const { return m_scheduler->GetProfiler(); }
+    int GetSlotsPerFrame() const { return m_scheduler->GetSlotsPerFrame(); }
+
+    // Checkpoint dello stato completo (cinematica, droni, banca EKF, consenso, generatori casuali,
+    // scheduler) all'istante corrente, dopo Start(). LoadCheckpoint va chiamata prima di Start()
+    // e solo con l'EventLoop proprio: la run riprende dallo slot successivo con gli stessi
+    // risultati della run non interrotta. Lo scenario deve avere lo stesso sciame (numero di droni,
+    // formazione, slot_duration); il resto (attacco, sim_time) puo' cambiare per esplorare varianti.
+    // Se LoadCheckpoint fallisce lo stato e' parzialmente sovrascritto: la SwarmSimulation va scartata.
+    bool SaveCheckpoint(const string& path, string& error) const;
+    bool LoadCheckpoint(const string& path, string& error);
+
+private:
+    void CreateScheduler();
+
+    Scenario m_scenario;
+    bool m_verbose;
+    unique_ptr<EventLoop> m_own_clock;
+    SimClock* m_clock;
+    UWBChannel m_channel;
+    SwarmFilterBank m_filter_bank;
+    KinematicsEngine m_kinematics;
+    vector<unique_ptr<Drone>> m_swarm;
+    unique_ptr<SimulationLogger> m_logger;
+    unique_ptr<TDMAScheduler> m_scheduler;
+    WorkerPool* m_pool;
+    SlotRecordWriter* m_recorder;
+    ostream* m_schedule_log;
+    MetricsAggregator* m_metrics;
+};
+
+#endif
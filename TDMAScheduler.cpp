@@ -0,0 +1,487 @@
+#include "TDMAScheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+using namespace Eigen;
+
+TDMAScheduler::TDMAScheduler(const Scenario& scenario, SimClock& clock, vector<unique_ptr<Drone>>& swarm, SwarmFilterBank& bank,
+                             KinematicsEngine& kinematics, UWBChannel& channel, SimulationLogger* logger)
+    : m_scenario(scenario), m_clock(clock), m_swarm(swarm), m_bank(bank), m_kinematics(kinematics), m_channel(channel), m_logger(logger),
+      m_mode(scenario.tdma_mode == "spatial_reuse" ? SLOT_SPATIAL_REUSE
+             : scenario.tdma_mode == "adaptive"    ? SLOT_ADAPTIVE : SLOT_ROUND_ROBIN),
+      m_filter_sync(scenario.clock_sync == "filter"), m_sync_from_sender(true),
+      m_current_slot_idx(0), m_frame_slot(0), m_next_slot_ps(-1), m_pool(nullptr), m_recorder(nullptr), m_metrics(nullptr), m_grid_time(-std::numeric_limits<double>::infinity()),
+      m_schedule_log(nullptr), m_reuse_grid_time(-std::numeric_limits<double>::infinity()),
+      m_group_begin(nullptr), m_group_end(nullptr)
+{
+    // Un generatore per ricevitore/osservatore: l'esito dello slot non dipende dall'ordine
+    // (o dal thread) con cui vengono processati i droni
+    m_channel.SetNumReceivers(m_swarm.size());
+    for(size_t i = 0; i < m_swarm.size(); ++i) {
+        m_drop_rng.emplace_back(DeriveSeed(m_scenario.seed, STREAM_PACKET_LOSS + i));
+    }
+    m_stats.attack_time = m_scenario.time_of_malicious;
+    m_profiler.SetBudget(m_scenario.slot_duration);
+    m_summary.assign(m_swarm.size(), SwarmFilterBank::TargetSummary{0, 0.0, 0.0, 0.0, 0.0});
+    m_last_tx_slot.assign(m_swarm.size(), -1);
+    m_last_tx_time.assign(m_swarm.size(), 0.0);
+}
+
+void TDMAScheduler::SetScheduleLog(ostream* out) {
+    m_schedule_log = out;
+    if (m_schedule_log) *m_schedule_log << "time,slot,sender,reason,priority,waited_slots,filters,position_var,nis,alarms\n";
+}
+
+void TDMAScheduler::Start() {
+    int64_t now_ps = m_clock.NowPicoSeconds();
+    if (m_next_slot_ps >= now_ps) {
+        m_clock.Schedule((m_next_slot_ps - now_ps) / 1e12, [this]() { ExecuteSlot(); });
+    } else {
+        ScheduleNextSlot();
+    }
+}
+
+void TDMAScheduler::SaveState(CheckpointWriter& out) const {
+    out.Put<int32_t>(m_current_slot_idx);
+    out.Put<int32_t>(m_frame_slot);
+    out.Put<int64_t>(m_next_slot_ps);
+    out.Put<uint32_t>((uint32_t)m_drop_rng.size());
+    for (const auto& rng : m_drop_rng) out.PutEngine(rng);
+    out.Put<RunStats>(m_stats);
+    out.Put<double>(m_grid_time);
+    out.PutVector(m_grid_points);
+    out.PutVector(m_summary);
+    out.PutVector(m_last_tx_slot);
+    out.PutVector(m_last_tx_time);
+    out.Put<double>(m_reuse_grid_time);
+    out.PutVector(m_reuse_rx_start);
+    out.PutVector(m_reuse_rx_ids);
+}
+
+bool TDMAScheduler::LoadState(CheckpointReader& in) {
+    m_current_slot_idx = in.Get<int32_t>();
+    m_frame_slot = in.Get<int32_t>();
+    m_next_slot_ps = in.Get<int64_t>();
+    if (in.Get<uint32_t>() != m_drop_rng.size()) return false;
+    for (auto& rng : m_drop_rng) in.GetEngine(rng);
+    m_stats = in.Get<RunStats>();
+    m_grid_time = in.Get<double>();
+    in.GetVector(m_grid_points);
+    in.GetVector(m_summary, m_swarm.size());
+    in.GetVector(m_last_tx_slot, m_swarm.size());
+    in.GetVector(m_last_tx_time, m_swarm.size());
+    m_reuse_grid_time = in.Get<double>();
+    in.GetVector(m_reuse_rx_start);
+    in.GetVector(m_reuse_rx_ids);
+    if (!in.Ok()) return false;
+
+    // L'attacco e' quello dello scenario corrente (la variante), griglia e gruppi quelli salvati:
+    // a meta' frame la griglia puo' essere piu' recente della colorazione
+    m_stats.attack_time = m_scenario.time_of_malicious;
+    if (IsRangeLimited() && m_grid_points.size() == m_swarm.size()) {
+        m_grid.Build(m_grid_points, m_scenario.uwb_range);
+        if (UsesSpatialReuse() && m_reuse_rx_start.size() == m_swarm.size() + 1)
+            m_coloring.Build(m_swarm.size(), m_reuse_rx_start, m_reuse_rx_ids);
+        else if (UsesSpatialReuse()) RebuildReuseGroups();
+    }
+    return m_frame_slot == 0 || (UsesSpatialReuse() && m_frame_slot < m_coloring.GetNumGroups());
+}
+
+// Ricostruire la griglia a ogni slot costerebbe O(N) per slot: i vicini vengono aggiornati
+// ogni GRID_REFRESH_S, le distanze usate dal canale restano quelle esatte dello slot
+bool TDMAScheduler::RefreshSpatialIndex(double now) {
+    if (!IsRangeLimited() || now - m_grid_time < GRID_REFRESH_S) return false;
+    m_grid_time = now;
+    m_grid_points.resize(m_swarm.size());
+    for(size_t i = 0; i < m_swarm.size(); ++i) m_grid_points[i] = m_swarm[i]->GetTruePosition();
+    m_grid.Build(m_grid_points, m_scenario.uwb_range);
+    return true;
+}
+
+// Ricevitori di tx_id: tutti gli altri droni, oppure quelli in portata / i piu' vicini
+// (posizioni dell'ultimo aggiornamento della griglia)
+void TDMAScheduler::SelectReceivers(int tx_id) {
+    m_receivers.clear();
+    if (!IsRangeLimited()) {
+        for(int i = 0; i < (int)m_swarm.size(); ++i) if(i != tx_id) m_receivers.push_back(i);
+        return;
+    }
+    const Vector3d& center = m_grid_points[tx_id];
+    if (m_scenario.max_neighbors > 0) {
+        double radius = m_scenario.uwb_range > 0 ? m_scenario.uwb_range : std::numeric_limits<double>::infinity();
+        m_grid.QueryNearest(center, m_scenario.max_neighbors, radius, tx_id, m_receivers);
+    } else {
+        m_grid.QueryRadius(center, m_scenario.uwb_range, tx_id, m_receivers);
+    }
+}
+
+// Interferenza: conta la portata fisica, non il limite di max_neighbors sui ricevitori
+void TDMAScheduler::SelectInterferers(int tx_id) {
+    m_receivers.clear();
+    if (m_scenario.uwb_range <= 0) {
+        for(int i = 0; i < (int)m_swarm.size(); ++i) if(i != tx_id) m_receivers.push_back(i);
+        return;
+    }
+    m_grid.QueryRadius(m_grid_points[tx_id], m_scenario.uwb_range, tx_id, m_receivers);
+}
+
+void TDMAScheduler::DropInterferedReceivers(int tx_id) {
+    const double range = m_scenario.uwb_range > 0 ? m_scenario.uwb_range : std::numeric_limits<double>::infinity();
+    auto interfered = [&](int rx) {
+        const Vector3d& rx_pos = m_swarm[rx]->GetTruePosition();
+        for(const int* u = m_group_begin; u != m_group_end; ++u) {
+            if (*u == tx_id) continue;
+            // Un drone che trasmette non riceve; altrimenti collisione se sente anche u
+            if (*u == rx || (m_swarm[*u]->GetTruePosition() - rx_pos).norm() <= range) return true;
+        }
+        return false;
+    };
+    m_receivers.erase(std::remove_if(m_receivers.begin(), m_receivers.end(), interfered), m_receivers.end());
+}
+
+// Droni in portata fisica di ognuno con la griglia corrente, poi gruppi di trasmettitori senza conflitti
+void TDMAScheduler::RebuildReuseGroups() {
+    const int n = m_swarm.size();
+    m_reuse_rx_start.resize(n + 1);
+    m_reuse_rx_start[0] = 0;
+    m_reuse_rx_ids.clear();
+    for(int v = 0; v < n; ++v) {
+        SelectInterferers(v);
+        m_reuse_rx_ids.insert(m_reuse_rx_ids.end(), m_receivers.begin(), m_receivers.end());
+        m_reuse_rx_start[v + 1] = m_reuse_rx_ids.size();
+    }
+    m_coloring.Build(n, m_reuse_rx_start, m_reuse_rx_ids);
+    m_reuse_grid_time = m_grid_time;
+}
+
+// Solo i ricevitori aggiornano i filtri: la banca viene chiamata sui tratti di id contigui
+void TDMAScheduler::ProcessReceiverRuns(const SwarmFilterBank::TransmitterBatch& batch, int tx_id,
+                                       const vector<RangingMeasurement>& packet)
+{
+    m_receiver_runs.clear();
+    for(size_t k = 0; k < m_receivers.size(); ) {
+        size_t e = k + 1;
+        while (e < m_receivers.size() && m_receivers[e] == m_receivers[e - 1] + 1) ++e;
+        m_receiver_runs.emplace_back(m_receivers[k], m_receivers[e - 1] + 1);
+        k = e;
+    }
+    ForEach((int)m_receiver_runs.size(), 1, [&](int begin, int end) {
+        for(int r = begin; r < end; ++r) {
+            int first = m_receiver_runs[r].first, last = m_receiver_runs[r].second;
+            for(int o = first; o < last; ++o) BuildReceiveMask(o, tx_id, packet);
+            m_bank.ProcessTransmitter(batch, first, last);
+        }
+    });
+}
+
+void TDMAScheduler::ScheduleNextSlot() {
+    m_next_slot_ps = m_clock.NowPicoSeconds() + SimClock::ToPicoSeconds(m_scenario.slot_duration);
+    m_clock.Schedule(m_scenario.slot_duration, [this]() { ExecuteSlot(); });
+}
+
+// Link tx -> rx: misura di ToA (o correzione di clock se tx e' il Master Anchor)
+void TDMAScheduler::EvaluateLink(int rx_id, int tx_id, const UWBMessage& msg, const Vector3d& tx_true_pos,
+                                 const ChannelCondition& cond, double tx_time_sec, double now)
+{
+    m_rx_valid[rx_id] = 0;
+    if(rx_id == tx_id) return;
+
+    Drone* rx = m_swarm[rx_id].get();
+    Vector3d rx_pos_phys = rx->GetTruePosition();
+
+    double dist = (tx_true_pos - rx_pos_phys).norm();
+    double c = 299792458.0;
+    double tof = dist / c;
+    double rx_clock_error = rx->GetClockError(now);
+    double measured_toa_raw = now + tof + (cond.ranging_error_m / c) + rx_clock_error;
+
+    if (IsSyncSlot(tx_id)) {
+        double geo_dist = (msg.gps_position - rx->GetGPSPosition()).norm();
+        double expected_tof = geo_dist / c;
+
+        double expected_arrival = tx_time_sec + expected_tof;
+        double clock_error = measured_toa_raw - expected_arrival;
+
+        double current_offset = rx->GetClockOffset();
+        rx->SetClockOffset(current_offset * 0.2 + clock_error * 0.8);
+        return;
+    }
+    Vector3d rx_gps = rx->GetGPSPosition();
+    double corrected_toa;
+    if (m_filter_sync) {
+        // Il ToA si corregge con la stima precedente al link, poi il link aggiorna il filtro:
+        // la stessa misura non entra due volte. Il Master e' il riferimento (varianza nulla) e non
+        // si aggiorna; niente aggiornamenti da link NLOS, da mittenti non agganciati (varianza
+        // infinita) o in allarme di consenso. Si misura solo tra clock agganciati: un ToA con
+        // l'offset ancora da stimare porterebbe un bias che sparisce al primo aggancio
+        const int master = m_scenario.master_anchor_id;
+        ClockFilter& clock = rx->GetClockFilter();
+        bool ranging = (rx_id == master || clock.IsLocked(now)) && (tx_id == master || std::isfinite(msg.clock_offset_var));
+        corrected_toa = measured_toa_raw - clock.Offset(now);
+        double tx_variance = tx_id == master ? 0.0 : msg.clock_offset_var;
+        if (rx_id != master && cond.is_los && std::isfinite(tx_variance) && m_sync_from_sender) {
+            double expected_tof = (msg.gps_position - rx_gps).norm() / c;
+            clock.Update(now, measured_toa_raw - tx_time_sec - expected_tof, CLOCK_SYNC_VARIANCE + tx_variance, tx_id == master);
+        }
+        if (!ranging) return;
+    } else {
+        corrected_toa = measured_toa_raw - rx->GetClockOffset();
+    }
+    RangingMeasurement& m = m_rx_measurement[rx_id];
+    m.target_id = tx_id;
+    m.anchor_id = rx_id;
+    m.anchor_pos = rx_gps;
+    m.toa_seconds = corrected_toa;
+    m.is_los = cond.is_los;
+    m_rx_valid[rx_id] = 1;
+}
+
+// keep[m * N + observer]: la misura m e' arrivata all'osservatore?
+void TDMAScheduler::BuildReceiveMask(int observer_id, int tx_id, const vector<RangingMeasurement>& packet) {
+    if(observer_id == tx_id) return;
+    std::uniform_real_distribution<> drop_chance(0.0, 1.0);
+    const int n_drones = m_swarm.size();
+
+    for(size_t k = 0; k < packet.size(); ++k) {
+        const auto& m = packet[k];
+        bool received = ((int)m.anchor_id == observer_id) || (drop_chance(m_drop_rng[observer_id]) > m_scenario.packet_loss_rate);
+        m_keep_mask[k * n_drones + observer_id] = received ? 1 : 0;
+    }
+}
+
+void TDMAScheduler::ExecuteSlot() {
+    double now = m_clock.Now();
+    if(now > m_scenario.sim_time) return;
+    TDOA_PROFILE_SCOPE(m_profiler, SlotProfiler::PHASE_SLOT);
+
+    m_kinematics.SetTime(now);
+    if (UsesSpatialReuse()) {
+        // I trasmettitori di un gruppo non hanno ricevitori in comune: processarli uno dopo
+        // l'altro allo stesso istante equivale a farli trasmettere insieme
+        RefreshSpatialIndex(now);
+        if (m_frame_slot == 0 && (m_reuse_grid_time != m_grid_time || m_coloring.GetNumGroups() == 0)) RebuildReuseGroups();
+        m_group_begin = m_coloring.GroupBegin(m_frame_slot);
+        m_group_end = m_coloring.GroupEnd(m_frame_slot);
+        for(const int* tx = m_group_begin; tx != m_group_end; ++tx) {
+            Transmit(*tx, now);
+        }
+        m_frame_slot = (m_frame_slot + 1) % m_coloring.GetNumGroups();
+    } else if (m_mode == SLOT_ADAPTIVE) {
+        RefreshSpatialIndex(now);
+        int tx_id = SelectAdaptiveTransmitter(now);
+        Transmit(tx_id, now);
+        m_summary[tx_id] = m_bank.SummarizeTarget(tx_id);
+        m_last_tx_slot[tx_id] = m_current_slot_idx;
+        m_last_tx_time[tx_id] = now;
+    } else {
+        RefreshSpatialIndex(now);
+        Transmit(m_current_slot_idx % m_swarm.size(), now);
+    }
+
+    m_current_slot_idx++;
+    ScheduleNextSlot();
+}
+
+// Priorita' di ogni drone dalle statistiche dei suoi filtri, O(N) per slot sui riassunti salvati
+// dopo ogni trasmissione. In ordine: Master Anchor alla cadenza del round robin, droni che non
+// hanno mai trasmesso (id crescenti), droni in attesa da troppo, poi la priorita' piu' alta
+int TDMAScheduler::SelectAdaptiveTransmitter(double now) {
+    const int n = m_swarm.size();
+    const int slot = m_current_slot_idx;
+    // Con il ClockFilter il Master Anchor e' un drone come gli altri
+    const int master = m_filter_sync ? -1 : m_scenario.master_anchor_id;
+    const int max_wait = ADAPTIVE_MAX_WAIT_FRAMES * n;
+    const SwarmConsensus& consensus = m_bank.GetConsensus();
+
+    auto waited = [&](int i) { return m_last_tx_slot[i] < 0 ? slot + 1 : slot - m_last_tx_slot[i]; };
+    auto boost = [&](int i) {
+        double nis_excess = std::max(0.0, m_summary[i].nis - 1.0);
+        double alarms = n > 1 ? (double)consensus.AlarmCount(i) / (n - 1) : 0.0;
+        return std::min(ADAPTIVE_MAX_BOOST, (1.0 + nis_excess) * (1.0 + ADAPTIVE_ALARM_GAIN * alarms));
+    };
+
+    int tx_id = -1;
+    const char* reason = "priority";
+    double priority = 0.0;
+    bool master_valid = master >= 0 && master < n;
+    if (master_valid && m_last_tx_slot[master] >= 0 && waited(master) >= n) {
+        tx_id = master;
+        reason = "master";
+    }
+    for (int i = 0; i < n && tx_id < 0; ++i) {
+        if (m_last_tx_slot[i] < 0) {
+            tx_id = i;
+            reason = "initial";
+        }
+    }
+    if (tx_id < 0) {
+        int longest = 0;
+        for (int i = 0; i < n; ++i) {
+            if (i == master) continue;
+            int w = waited(i);
+            if (w >= max_wait && w > longest) {
+                longest = w;
+                tx_id = i;
+                reason = "starved";
+            }
+        }
+    }
+    const bool scored = tx_id < 0;
+    if (scored) {
+        for (int i = 0; i < n; ++i) {
+            if (i == master && master_valid) continue;
+            double p = m_summary[i].PredictedPositionVariance(now - m_last_tx_time[i]) * boost(i);
+            if (tx_id < 0 || p > priority) {
+                priority = p;
+                tx_id = i;
+            }
+        }
+    }
+
+    if (m_schedule_log) {
+        const SwarmFilterBank::TargetSummary& sum = m_summary[tx_id];
+        // Nei casi forzati la priorita' si calcola solo per il log
+        if (!scored && m_last_tx_slot[tx_id] >= 0)
+            priority = sum.PredictedPositionVariance(now - m_last_tx_time[tx_id]) * boost(tx_id);
+        *m_schedule_log << now << "," << slot << "," << tx_id << "," << reason << "," << priority << ","
+                        << (m_last_tx_slot[tx_id] < 0 ? -1 : waited(tx_id)) << "," << sum.filters << ","
+                        << sum.PredictedPositionVariance(now - m_last_tx_time[tx_id]) << "," << sum.nis << ","
+                        << consensus.AlarmCount(tx_id) << "\n";
+    }
+    return tx_id;
+}
+
+// Una trasmissione: canale e misure dei ricevitori, update EKF, voto SwarmRaft e recupero
+void TDMAScheduler::Transmit(int tx_id, double now) {
+    Drone* sender = m_swarm[tx_id].get();
+    const int n_drones = m_swarm.size();
+
+    UWBMessage& msg = m_msg;
+    sender->CreateTDMAMessage(msg);
+    Vector3d tx_true_pos = sender->GetTruePosition();
+    double tx_time_sec = msg.tx_timestamp_ps / 1e12;
+    // Con il ClockFilter il mittente riporta il timestamp al tempo del Master con la propria stima
+    if (m_filter_sync) tx_time_sec -= msg.clock_offset;
+
+    SelectReceivers(tx_id);
+    if (UsesSpatialReuse()) DropInterferedReceivers(tx_id);
+    m_rx_measurement.resize(n_drones);
+    m_rx_valid.resize(n_drones);
+    if (m_filter_sync) {
+        // Un trasmettitore gia' in allarme di consenso non sincronizza i clock: le sue
+        // posizioni dichiarate falserebbero l'offset osservato. Un singolo ricevitore non basta,
+        // un clock fuori aggancio vedrebbe in allarme tutti i vicini e non si riaggancerebbe piu'
+        const SwarmConsensus& consensus = m_bank.GetConsensus();
+        int votes = IsRangeLimited() ? consensus.VoteSumAmong(tx_id, m_receivers) : consensus.VoteSum(tx_id);
+        m_sync_from_sender = votes > SwarmConsensus::ALARM_VOTE_SUM;
+    }
+    const int n_rx = m_receivers.size();
+    m_rx_pos.resize(n_rx);
+    m_rx_cond.Resize(n_rx);
+    {
+        // Negli slot di sola sincronizzazione (Master Anchor, clock_sync = master) i link correggono solo i clock
+        TDOA_PROFILE_SCOPE(m_profiler, IsSyncSlot(tx_id) ? SlotProfiler::PHASE_CLOCK_SYNC : SlotProfiler::PHASE_CHANNEL);
+        ForEach(n_rx, CHANNEL_GRAIN, [&](int begin, int end) {
+            for(int k = begin; k < end; ++k) m_rx_pos[k] = m_swarm[m_receivers[k]]->GetTruePosition();
+            m_channel.ComputeChannelConditions(tx_true_pos, m_rx_pos.data(), m_receivers.data(), begin, end, 0.0, m_rx_cond);
+            for(int k = begin; k < end; ++k) EvaluateLink(m_receivers[k], tx_id, msg, tx_true_pos, m_rx_cond.At(k), tx_time_sec, now);
+        });
+    }
+    TDOA_PROFILE_COUNT(m_profiler, SlotProfiler::COUNT_LINKS, n_rx);
+    if (IsSyncSlot(tx_id)) TDOA_PROFILE_COUNT(m_profiler, SlotProfiler::COUNT_CLOCK_CORRECTIONS, n_rx);
+
+    vector<RangingMeasurement>& shared_data_packet = m_packet;
+    shared_data_packet.clear();
+    for(int i : m_receivers) {
+        if(m_rx_valid[i]) shared_data_packet.push_back(m_rx_measurement[i]);
+    }
+    TDOA_PROFILE_COUNT(m_profiler, SlotProfiler::COUNT_MEASUREMENTS, shared_data_packet.size());
+    if (m_recorder) m_recorder->Write(tx_id, now, tx_time_sec, msg.gps_position, shared_data_packet);
+
+    // Con la portata limitata si leggono solo le colonne dei ricevitori, tutte riscritte
+    if (IsRangeLimited()) m_keep_mask.resize(shared_data_packet.size() * n_drones);
+    else m_keep_mask.assign(shared_data_packet.size() * n_drones, 0);
+
+    SwarmFilterBank::TransmitterBatch batch;
+    batch.target = tx_id;
+    batch.claimed_gps = msg.gps_position;
+    batch.measurements = shared_data_packet.data();
+    batch.num_measurements = (int)shared_data_packet.size();
+    batch.keep = m_keep_mask.data();
+    batch.keep_stride = n_drones;
+    batch.current_time = now;
+    batch.tx_timestamp = tx_time_sec;
+
+    // Ogni osservatore tocca solo la propria colonna della maschera e le proprie corsie della banca
+    {
+        TDOA_PROFILE_SCOPE(m_profiler, SlotProfiler::PHASE_EKF_UPDATE);
+        if (IsRangeLimited()) {
+            ProcessReceiverRuns(batch, tx_id, shared_data_packet);
+        } else {
+            ForEachDrone(SwarmFilterBank::LANE_BLOCK, [&](int begin, int end) {
+                for(int o = begin; o < end; ++o) BuildReceiveMask(o, tx_id, shared_data_packet);
+                m_bank.ProcessTransmitter(batch, begin, end);
+            });
+        }
+    }
+
+// --- (SWARMRAFT) ---
+    // Il conteggio degli allarmi su tx_id e' mantenuto dalla banca a ogni cambio di flag;
+    // con la portata limitata votano solo i ricevitori dello slot
+    Vector3d recovered_pos;
+    bool consensus_alarm;
+    int total_votes;
+    {
+        TDOA_PROFILE_SCOPE(m_profiler, SlotProfiler::PHASE_TALLY);
+        const SwarmConsensus& consensus = m_bank.GetConsensus();
+        total_votes = IsRangeLimited() ? consensus.VoteSumAmong(tx_id, m_receivers) : consensus.VoteSum(tx_id);
+        consensus_alarm = total_votes <= SwarmConsensus::ALARM_VOTE_SUM;
+        if (consensus_alarm) {
+            m_peer_estimates.clear();
+            for(int observer_id : m_receivers) {
+                m_peer_estimates.push_back(m_swarm[observer_id]->GetEstimatedPositionOf(tx_id));
+            }
+            recovered_pos = m_swarm[0]->GetRecoveredPosition(m_peer_estimates.data(), (int)m_peer_estimates.size());
+            m_swarm[tx_id]->ResetState(recovered_pos);
+            TDOA_PROFILE_COUNT(m_profiler, SlotProfiler::COUNT_CONSENSUS_ALARMS, 1);
+        } else {
+            recovered_pos = msg.gps_position;
+        }
+    }
+    RecordStats(tx_id, now, total_votes, consensus_alarm, recovered_pos);
+    if (m_logger) {
+        TDOA_PROFILE_SCOPE(m_profiler, SlotProfiler::PHASE_LOGGING);
+        for(int i : m_receivers) m_logger->LogObservation(now, tx_id, i, msg.gps_position, recovered_pos);
+        TDOA_PROFILE_COUNT(m_profiler, SlotProfiler::COUNT_LOG_RECORDS, m_receivers.size());
+    }
+}
+
+void TDMAScheduler::RecordStats(int tx_id, double now, int vote_sum, bool consensus_alarm, const Vector3d& recovered_pos) {
+    Drone* sender = m_swarm[tx_id].get();
+    Vector3d truth = sender->GetTruePosition();
+
+    // Gli slot di sola sincronizzazione non portano misure di ranging: le stime del Master non vengono aggiornate
+    bool ranging = !IsSyncSlot(tx_id);
+    if (ranging || m_metrics) {
+        for(int i : m_receivers) {
+            double err = (m_swarm[i]->GetEstimatedPositionOf(tx_id) - truth).norm();
+            if (ranging) {
+                m_stats.sq_error_sum += err * err;
+                m_stats.observations++;
+            }
+            if (m_metrics) m_metrics->AddObservation(now, tx_id, i, err, m_bank.IsAlarmActive(i, tx_id), ranging);
+        }
+    }
+    if (m_metrics) m_metrics->AddDecision(now, tx_id, vote_sum, consensus_alarm, (recovered_pos - truth).norm());
+
+    if (sender->IsMalicious()) {
+        if (consensus_alarm && m_stats.first_alarm_time < 0) m_stats.first_alarm_time = now;
+        m_stats.recovery_error_sum += (recovered_pos - truth).norm();
+        m_stats.recovery_samples++;
+    } else {
+        m_stats.honest_decisions++;
+        if (consensus_alarm) m_stats.false_alarms++;
+    }
+}
@@ -0,0 +1,187 @@
+#ifndef TDMA_SCHEDULER_H
+#define TDMA_SCHEDULER_H
+
+#include "Drone.h"
+#include "UWBChannel.h"
+#include "SwarmFilterBank.h"
+#include "SimulationLogger.h"
+#include "WorkerPool.h"
+#include "SpatialGrid.h"
+#include "TransmitterColoring.h"
+#include "KinematicsEngine.h"
+#include "SimClock.h"
+#include "SlotProfiler.h"
+#include "SlotRecord.h"
+#include "Scenario.h"
+#include "RunStats.h"
+#include "MetricsAggregator.h"
+#include <memory>
+#include <ostream>
+#include <vector>
+#include <random>
+
+using namespace std;
+using namespace Eigen;
+
+/**
+ * Round Robin TDMA: in ogni slot trasmette un solo drone, gli altri misurano il ToA,
+ * aggiornano i propri EKF e votano (SwarmRaft). Se il trasmettitore e' il Master Anchor
+ * lo slot serve solo a correggere l'offset di clock dei ricevitori. Con scenario.clock_sync =
+ * filter invece ogni link in LOS aggiorna il ClockFilter (offset + skew) del ricevitore, i
+ * timestamp vengono corretti con le stime dei due clock e lo slot del Master porta ranging
+ * come gli altri.
+ *
+ * Con scenario.uwb_range e/o scenario.max_neighbors solo i droni in portata (o i k piu'
+ * vicini) ricevono lo slot: misurano, aggiornano i filtri del trasmettitore e votano.
+ * I vicini si cercano in una SpatialGrid ricostruita ogni GRID_REFRESH_S secondi di simulazione.
+ *
+ * Con scenario.tdma_mode = spatial_reuse (e la portata limitata) piu' droni trasmettono nello
+ * stesso slot: i trasmettitori vengono divisi in gruppi che non interferiscono (TransmitterColoring)
+ * e ogni slot serve un gruppo, quindi un giro (frame) dura tanti slot quanti sono i gruppi
+ * invece di N. Il grafo dei conflitti usa la portata fisica (uwb_range), anche quando a limitare
+ * la ricezione e' solo max_neighbors: senza uwb_range tutti interferiscono con tutti e i gruppi
+ * sono singoli. I gruppi si ricalcolano solo a inizio frame (ogni drone trasmette una volta per
+ * frame), i ricevitori invece a ogni slot come nel round robin, e un ricevitore in portata di
+ * due trasmettitori dello stesso slot (posizioni vere all'istante dello slot) viene scartato.
+ *
+ * Costo in accuratezza: con clock_sync = master i droni fuori portata del Master Anchor non si
+ * sincronizzano mai, e frame piu' corti li aggiornano piu' spesso con misure distorte; la loro
+ * deriva porta l'RMSE a 1.3-2.3 volte quello del round robin (32 droni, uwb_range = 60). Con
+ * clock_sync = filter il riuso non peggiora l'RMSE (bench_tdoa_suite lo controlla).
+ *
+ * Con scenario.tdma_mode = adaptive lo slot va al drone con la priorita' piu' alta: la traccia
+ * media della covarianza di posizione che i suoi osservatori prevedono per l'istante dello slot
+ * (cresce con il tempo dall'ultima trasmissione), amplificata dall'innovazione normalizzata
+ * dell'ultimo update e dagli allarmi attivi su di lui. I droni gia' tracciati con precisione
+ * trasmettono meno, quelli incerti o sospetti di piu'. Il Master Anchor mantiene la cadenza del
+ * round robin (un slot ogni N) e nessun drone aspetta piu' di ADAPTIVE_MAX_WAIT_FRAMES giri.
+ *
+ * All'inizio di ogni slot il KinematicsEngine viene portato all'istante dello slot: le
+ * posizioni vere lette durante lo slot sono quelle esatte a quel tempo.
+ */
+class TDMAScheduler {
+public:
+    enum SlotMode {
+        SLOT_ROUND_ROBIN,    // un trasmettitore per slot, a turno
+        SLOT_SPATIAL_REUSE,  // un gruppo di trasmettitori non interferenti per slot
+        SLOT_ADAPTIVE        // un trasmettitore per slot, scelto dalle statistiche dei filtri
+    };
+
+    TDMAScheduler(const Scenario& scenario, SimClock& clock, vector<unique_ptr<Drone>>& swarm, SwarmFilterBank& bank,
+                  KinematicsEngine& kinematics, UWBChannel& channel, SimulationLogger* logger);
+
+    // Con un pool, canale e osservatori di ogni slot vengono processati in parallelo
+    void SetWorkerPool(WorkerPool* pool) { m_pool = pool; }
+    // Registra ogni slot (trasmettitore, GPS dichiarato, misure) per tdoa_replay
+    void SetSlotRecorder(SlotRecordWriter* recorder) { m_recorder = recorder; }
+    void SetLogger(SimulationLogger* logger) { m_logger = logger; }
+    // Indicatori in streaming: ogni osservazione e ogni decisione di consenso (nullptr = nessuno)
+    void SetMetrics(MetricsAggregator* metrics) { m_metrics = metrics; }
+    // Decisioni dello scheduler adattivo in CSV, una riga per slot (nullptr = nessun log)
+    void SetScheduleLog(ostream* out);
+
+    // Pianifica il prossimo slot: dopo LoadState all'istante salvato, altrimenti tra slot_duration
+    void Start();
+
+    // Indice di slot, generatori delle perdite, indicatori accumulati, griglia e istante del prossimo slot
+    void SaveState(CheckpointWriter& out) const;
+    bool LoadState(CheckpointReader& in);
+    const RunStats& GetStats() const { return m_stats; }
+    // Slot di un giro completo dello sciame: N in round robin, il numero di gruppi con il riuso
+    int GetSlotsPerFrame() const { return UsesSpatialReuse() ? m_coloring.GetNumGroups() : (int)m_swarm.size(); }
+    // Tempi per fase degli slot; vuoto se compilato senza TDOA_PROFILE
+    const SlotProfiler& GetProfiler() const { return m_profiler; }
+
+private:
+    static const int CHANNEL_GRAIN = 16;
+    static constexpr double GRID_REFRESH_S = 0.05;
+    // Scheduler adattivo: attesa massima in giri da N slot, guadagno degli allarmi (tutti gli
+    // osservatori in allarme = 1 + ADAPTIVE_ALARM_GAIN) e amplificazione massima della priorita'
+    static const int ADAPTIVE_MAX_WAIT_FRAMES = 2;
+    static constexpr double ADAPTIVE_ALARM_GAIN = 9.0;
+    static constexpr double ADAPTIVE_MAX_BOOST = 10.0;
+    // Varianza di un'osservazione di offset del ClockFilter (errore di ranging e GPS, ~0.3 m)
+    static constexpr double CLOCK_SYNC_VARIANCE = (0.3 / 299792458.0) * (0.3 / 299792458.0);
+
+    void ScheduleNextSlot();
+    void ExecuteSlot();
+
+    template <class F>
+    void ForEach(int n, int grain, F&& fn) {
+        if (m_pool) m_pool->ParallelFor(n, grain, fn);
+        else fn(0, n);
+    }
+    template <class F>
+    void ForEachDrone(int grain, F&& fn) { ForEach((int)m_swarm.size(), grain, fn); }
+
+    // Slot del Master Anchor usato solo per la sincronizzazione (clock_sync = master)
+    bool IsSyncSlot(int tx_id) const { return !m_filter_sync && tx_id == m_scenario.master_anchor_id; }
+    bool IsRangeLimited() const { return m_scenario.uwb_range > 0 || m_scenario.max_neighbors > 0; }
+    // Senza portata limitata tutti sentono tutti: il riuso degenera nel round robin
+    bool UsesSpatialReuse() const { return m_mode == SLOT_SPATIAL_REUSE && IsRangeLimited(); }
+    bool RefreshSpatialIndex(double now);
+    void SelectReceivers(int tx_id);
+    // Droni in portata fisica di tx_id (tutti gli altri senza uwb_range), in m_receivers
+    void SelectInterferers(int tx_id);
+    // Toglie da m_receivers chi e' in portata di un altro trasmettitore del gruppo corrente
+    void DropInterferedReceivers(int tx_id);
+    void RebuildReuseGroups();
+    int SelectAdaptiveTransmitter(double now);
+    void Transmit(int tx_id, double now);
+    void ProcessReceiverRuns(const SwarmFilterBank::TransmitterBatch& batch, int tx_id,
+                             const vector<RangingMeasurement>& packet);
+
+    void EvaluateLink(int rx_id, int tx_id, const UWBMessage& msg, const Vector3d& tx_true_pos,
+                      const ChannelCondition& cond, double tx_time_sec, double now);
+    void BuildReceiveMask(int observer_id, int tx_id, const vector<RangingMeasurement>& packet);
+    void RecordStats(int tx_id, double now, int vote_sum, bool consensus_alarm, const Vector3d& recovered_pos);
+
+    const Scenario& m_scenario;
+    SimClock& m_clock;
+    vector<unique_ptr<Drone>>& m_swarm;
+    SwarmFilterBank& m_bank;
+    KinematicsEngine& m_kinematics;
+    UWBChannel& m_channel;
+    SimulationLogger* m_logger;
+    SlotMode m_mode;
+    bool m_filter_sync;                    // clock_sync = filter
+    bool m_sync_from_sender;               // il trasmettitore dello slot corregge i clock
+    int m_current_slot_idx;
+    int m_frame_slot;                      // con il riuso: gruppo dello slot corrente
+    int64_t m_next_slot_ps;                // -1 finche' non e' pianificato alcuno slot
+    WorkerPool* m_pool;
+    SlotRecordWriter* m_recorder;
+    MetricsAggregator* m_metrics;
+    RunStats m_stats;
+    SlotProfiler m_profiler;
+    vector<std::mt19937> m_drop_rng;
+    vector<RangingMeasurement> m_rx_measurement;
+    vector<uint8_t> m_rx_valid;
+    vector<Vector3d> m_rx_pos;             // posizioni dei ricevitori, allineate a m_receivers
+    ChannelConditionBlock m_rx_cond;
+    vector<uint8_t> m_keep_mask;
+    // Buffer dello slot riusati: a regime ExecuteSlot non alloca
+    UWBMessage m_msg;
+    vector<RangingMeasurement> m_packet;
+    vector<Vector3d> m_peer_estimates;
+
+    SpatialGrid m_grid;
+    vector<Vector3d> m_grid_points;
+    double m_grid_time;
+    vector<int> m_receivers;               // ricevitori dello slot corrente, id crescenti
+    vector<pair<int, int>> m_receiver_runs;// tratti contigui [begin, end) di m_receivers
+
+    // Scheduler adattivo: riassunto dei filtri di ogni target dopo la sua ultima trasmissione
+    vector<SwarmFilterBank::TargetSummary> m_summary;
+    vector<int32_t> m_last_tx_slot;        // -1 = non ha ancora trasmesso
+    vector<double> m_last_tx_time;
+    ostream* m_schedule_log;
+
+    TransmitterColoring m_coloring;
+    vector<int> m_reuse_rx_start, m_reuse_rx_ids;   // droni in portata fisica di ognuno (CSR) per la colorazione
+    double m_reuse_grid_time;                        // griglia usata dall'ultima colorazione
+    const int* m_group_begin;                        // trasmettitori dello slot corrente (riuso spaziale)
+    const int* m_group_end;
+};
+
+#endif
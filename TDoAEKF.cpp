@@ -1,10 +1,11 @@
 #include "TDoAEKF.h"
 #include <iostream>
+#include <limits>
 
 using namespace Eigen;
 using namespace std;
 
-TDoAEKF::TDoAEKF() {
+TDoAEKF::TDoAEKF() : m_mode(UPDATE_BATCH), m_gate(0.0), m_rejected(0) {
     m_state = VectorXd::Zero(7);
     m_P = MatrixXd::Identity(7, 7);
     m_Q = MatrixXd::Identity(7, 7);
@@ -38,6 +39,10 @@ void TDoAEKF::Predict(double dt) {
 
 void TDoAEKF::Update(const vector<Msmnt>& measurements) {
     if (measurements.empty()) return;
+    if (m_mode == UPDATE_SEQUENTIAL) {
+        UpdateSequential(measurements);
+        return;
+    }
 
     int n = measurements.size();
     VectorXd Z(n);       
@@ -72,5 +77,59 @@ void TDoAEKF::Update(const vector<Msmnt>& measurements) {
     m_P = (MatrixXd::Identity(7, 7) - K * H) * m_P;
 }
 
+void TDoAEKF::UpdateSequential(const vector<Msmnt>& measurements) {
+    const double gate2 = m_gate > 0 ? m_gate * m_gate : std::numeric_limits<double>::infinity();
+
+    // H linearizzata nello stato predetto come nel modo batch: l'innovazione di ogni misura
+    // e' z - h(x0) - H (x - x0), cosi' senza gate il risultato coincide con l'update impilato.
+    // Il gate confronta invece ogni misura con la predizione (x0, P0): non dipende dall'ordine
+    // delle misure e un outlier elaborato per primo non puo' trascinare il bias e far scartare le altre
+    const Vector3d est_pos = m_state.segment<3>(0);
+    const double est_bias = m_state(6);
+    Matrix4d P0;
+    const int hcol[4] = {0, 1, 2, 6};
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j) P0(i, j) = m_P(hcol[i], hcol[j]);
+
+    // innovazione a priori y0 e linearizzazione h della misura nello stato predetto
+    auto prior = [&](const Msmnt& m, Vector4d& h) {
+        Vector3d diff = est_pos - m.anchor_pos;
+        double geo_dist = diff.norm();
+        h << diff / (geo_dist + 1e-9), 1.0;
+        return (m.toa - m.tx_timestamp) * c - (geo_dist + est_bias);
+    };
+    auto passes = [&](double y0, const Vector4d& h) { return y0 * y0 <= gate2 * (h.dot(P0 * h) + 2.0); };
+
+    // Come in SwarmFilterBank: se il gate lascerebbe meno di 4 misure l'errore e' comune a tutte
+    // (salto del bias di clock, filtro in ritardo) e l'update procede senza gate
+    bool apply_gate = false;
+    if (gate2 < std::numeric_limits<double>::infinity()) {
+        size_t accepted = 0;
+        Vector4d h;
+        for (const Msmnt& m : measurements) {
+            double y0 = prior(m, h);
+            accepted += passes(y0, h);
+        }
+        apply_gate = accepted >= MIN_GATED_MEASUREMENTS;
+    }
+
+    for (const Msmnt& m : measurements) {
+        Vector4d h;
+        double y0 = prior(m, h);
+        if (apply_gate && !passes(y0, h)) {
+            m_rejected++;
+            continue;
+        }
+
+        // P H^T: H ha colonne non nulle solo su posizione e bias
+        Matrix<double, 7, 1> ph = m_P.leftCols<3>() * h.head<3>() + m_P.col(6);
+        double s = h.head<3>().dot(ph.head<3>()) + ph(6) + 2.0;
+        double y = y0 - (h.head<3>().dot(m_state.segment<3>(0) - est_pos) + (m_state(6) - est_bias));
+
+        m_state += ph * (y / s);
+        m_P -= ph * ph.transpose() / s;
+    }
+}
+
 Vector3d TDoAEKF::GetPosition() const { return m_state.segment<3>(0); }
 VectorXd TDoAEKF::GetState() const { return m_state; }
@@ -2,6 +2,7 @@
 #define TDOAEKF_H
 
 #include <Eigen/Dense>
+#include <cstdint>
 #include <vector>
 
 using namespace Eigen;
@@ -9,6 +10,11 @@ using namespace std;
 
 class TDoAEKF {
 public:
+    // UPDATE_BATCH: misure impilate, S n x n invertita. UPDATE_SEQUENTIAL: una pseudorange alla
+    // volta con innovazione scalare e update di rango 1 di P (R e' diagonale, stesso risultato
+    // senza inversioni), costo lineare nel numero di ancore
+    enum UpdateMode { UPDATE_BATCH, UPDATE_SEQUENTIAL };
+
     TDoAEKF();
 
     struct Msmnt {
@@ -21,15 +27,27 @@ public:
     void Predict(double dt);
     void Update(const vector<Msmnt>& measurements);
 
+    void SetUpdateMode(UpdateMode mode) { m_mode = mode; }
+    // Solo in modo sequenziale: scarta le misure con |innovazione| > n_sigma * sqrt(S) (outlier NLOS).
+    // Se passerebbero meno di 4 misure l'update procede senza gate, come in SwarmFilterBank. 0 = nessun gate
+    void SetInnovationGate(double n_sigma) { m_gate = n_sigma; }
+    uint64_t GetRejectedCount() const { return m_rejected; }
+
     Vector3d GetPosition() const;
     VectorXd GetState() const;
     
 
 private:
+    void UpdateSequential(const vector<Msmnt>& measurements);
+
     VectorXd m_state;
     MatrixXd m_P;
     MatrixXd m_Q;    
+    UpdateMode m_mode;
+    double m_gate;
+    uint64_t m_rejected;
     const double c = 299792458.0; 
+    static const size_t MIN_GATED_MEASUREMENTS = 4;
 };
 
 #endif
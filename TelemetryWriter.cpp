@@ -0,0 +1,280 @@
+#include "TelemetryWriter.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+const char FILE_MAGIC[8] = {'T', 'D', 'O', 'A', 'T', 'L', 'M', '\0'};
+const uint32_t BLOCK_MAGIC = 0x314B4C42; // "BLK1"
+const uint32_t COMPRESSED_BLOCK_MAGIC = 0x324B4C42; // "BLK2"
+const uint32_t INDEX_MAGIC = 0x32584449; // "IDX2"
+// Livello deflate: il blocco si comprime nel thread che scrive (lo slot, senza --asyncLog)
+const int ZLIB_LEVEL = 4;
+const size_t NAME_LEN = 24;
+
+size_t PadTo8(size_t n) { return (n + 7) & ~(size_t)7; }
+
+template <class T>
+void Put(ofstream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void PutZeros(ofstream& out, size_t n) {
+    static const char zeros[8] = {0};
+    out.write(zeros, n);
+}
+
+}
+
+// ---------------------------------------------------------------- CSV
+
+CsvTelemetryWriter::CsvTelemetryWriter(const string& path) : m_out(path) {
+    if (m_out.is_open()) {
+        m_out << "time,sender_id,observer_id,est_x,est_y,est_z,claim_x,claim_y,claim_z,true_x,true_y,true_z,discrepancy,estimation_error,alarm,rec_x,rec_y,rec_z\n";
+    }
+}
+
+void CsvTelemetryWriter::Write(const ObservationRecord& r) {
+    m_out << r.time << "," << r.sender_id << "," << r.observer_id << ","
+    << r.est[0] << "," << r.est[1] << "," << r.est[2] << ","
+    << r.claim[0] << "," << r.claim[1] << "," << r.claim[2] << ","
+    << r.truth[0] << "," << r.truth[1] << "," << r.truth[2] << ","
+    << r.discrepancy << "," << r.estimation_error << "," << (int)r.alarm << ","
+    << r.rec[0] << "," << r.rec[1] << "," << r.rec[2] << "\n";
+}
+
+void CsvTelemetryWriter::Flush() { m_out.flush(); }
+
+// ---------------------------------------------------------------- Colonnare
+
+const vector<ColumnarTelemetryWriter::ColumnSpec>& ColumnarTelemetryWriter::Columns() {
+    static const vector<ColumnSpec> columns = {
+        {"time",             COL_F64, offsetof(ObservationRecord, time)},
+        {"sender_id",        COL_U32, offsetof(ObservationRecord, sender_id)},
+        {"observer_id",      COL_U32, offsetof(ObservationRecord, observer_id)},
+        {"est_x",            COL_F64, offsetof(ObservationRecord, est) + 0 * sizeof(double)},
+        {"est_y",            COL_F64, offsetof(ObservationRecord, est) + 1 * sizeof(double)},
+        {"est_z",            COL_F64, offsetof(ObservationRecord, est) + 2 * sizeof(double)},
+        {"claim_x",          COL_F64, offsetof(ObservationRecord, claim) + 0 * sizeof(double)},
+        {"claim_y",          COL_F64, offsetof(ObservationRecord, claim) + 1 * sizeof(double)},
+        {"claim_z",          COL_F64, offsetof(ObservationRecord, claim) + 2 * sizeof(double)},
+        {"true_x",           COL_F64, offsetof(ObservationRecord, truth) + 0 * sizeof(double)},
+        {"true_y",           COL_F64, offsetof(ObservationRecord, truth) + 1 * sizeof(double)},
+        {"true_z",           COL_F64, offsetof(ObservationRecord, truth) + 2 * sizeof(double)},
+        {"discrepancy",      COL_F64, offsetof(ObservationRecord, discrepancy)},
+        {"estimation_error", COL_F64, offsetof(ObservationRecord, estimation_error)},
+        {"alarm",            COL_U8,  offsetof(ObservationRecord, alarm)},
+        {"rec_x",            COL_F64, offsetof(ObservationRecord, rec) + 0 * sizeof(double)},
+        {"rec_y",            COL_F64, offsetof(ObservationRecord, rec) + 1 * sizeof(double)},
+        {"rec_z",            COL_F64, offsetof(ObservationRecord, rec) + 2 * sizeof(double)},
+    };
+    return columns;
+}
+
+size_t ColumnarTelemetryWriter::ElemSize(ColumnType type) {
+    switch (type) {
+        case COL_F64: return 8;
+        case COL_U32: return 4;
+        default:      return 1;
+    }
+}
+
+ColumnarTelemetryWriter::ColumnarTelemetryWriter(const string& path, uint32_t rows_per_block, Codec codec,
+                                                 uint32_t mantissa_bits, uint64_t expected_rows)
+    : m_out(path, ios::binary), m_rows_per_block(rows_per_block), m_rows(0), m_codec(codec),
+      m_mantissa_bits(std::min<uint32_t>(std::max<uint32_t>(mantissa_bits, 1), FULL_MANTISSA_BITS)), m_zstream(),
+      m_zstream_ready(false)
+{
+    const auto& cols = Columns();
+    m_column_data.resize(cols.size());
+    for (size_t c = 0; c < cols.size(); ++c) {
+        m_column_data[c].resize((size_t)m_rows_per_block * ElemSize(cols[c].type));
+    }
+    if (m_codec == CODEC_ZLIB) {
+        m_zstream_ready = deflateInit(&m_zstream, ZLIB_LEVEL) == Z_OK;
+        if (!m_zstream_ready) {
+            m_out.close();
+            return;
+        }
+        size_t max_bytes = (size_t)m_rows_per_block * sizeof(double);
+        m_encoded.resize(max_bytes);
+        m_compressed.resize(cols.size());
+        m_encodings.resize(cols.size());
+        m_stored.resize(cols.size());
+        for (size_t c = 0; c < cols.size(); ++c) {
+            m_compressed[c].resize(deflateBound(&m_zstream, (uLong)((size_t)m_rows_per_block * ElemSize(cols[c].type))));
+        }
+        // Un blocco ogni rows_per_block righe, piu' quello parziale del Flush finale
+        m_index.reserve(expected_rows > 0 ? (size_t)(expected_rows / m_rows_per_block + 1) : 4096);
+    }
+    if (m_out.is_open()) WriteHeader();
+}
+
+ColumnarTelemetryWriter::~ColumnarTelemetryWriter() {
+    Flush();
+    if (m_codec == CODEC_ZLIB) WriteIndex();
+    if (m_zstream_ready) deflateEnd(&m_zstream);
+}
+
+void ColumnarTelemetryWriter::WriteHeader() {
+    const auto& cols = Columns();
+    uint32_t header_bytes = (uint32_t)PadTo8(sizeof(FILE_MAGIC) + 4 * sizeof(uint32_t) + cols.size() * (NAME_LEN + 2 * sizeof(uint32_t)));
+
+    m_out.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+    Put<uint32_t>(m_out, m_codec == CODEC_ZLIB ? COMPRESSED_VERSION : VERSION);
+    Put<uint32_t>(m_out, (uint32_t)cols.size());
+    Put<uint32_t>(m_out, m_rows_per_block);
+    Put<uint32_t>(m_out, header_bytes);
+
+    size_t written = sizeof(FILE_MAGIC) + 4 * sizeof(uint32_t);
+    for (const auto& col : cols) {
+        char name[NAME_LEN] = {0};
+        strncpy(name, col.name, NAME_LEN - 1);
+        m_out.write(name, NAME_LEN);
+        Put<uint32_t>(m_out, col.type);
+        Put<uint32_t>(m_out, (uint32_t)ElemSize(col.type));
+        written += NAME_LEN + 2 * sizeof(uint32_t);
+    }
+    PutZeros(m_out, header_bytes - written);
+}
+
+void ColumnarTelemetryWriter::Write(const ObservationRecord& rec) {
+    const auto& cols = Columns();
+    const char* src = reinterpret_cast<const char*>(&rec);
+    for (size_t c = 0; c < cols.size(); ++c) {
+        size_t sz = ElemSize(cols[c].type);
+        memcpy(&m_column_data[c][(size_t)m_rows * sz], src + cols[c].offset, sz);
+    }
+    if (++m_rows == m_rows_per_block) WriteBlock();
+}
+
+void ColumnarTelemetryWriter::WriteBlock() {
+    if (m_rows == 0 || !m_out.is_open()) return;
+    if (m_codec == CODEC_ZLIB) {
+        WriteCompressedBlock();
+        return;
+    }
+
+    const auto& cols = Columns();
+    uint64_t payload = 0;
+    for (const auto& col : cols) payload += PadTo8((size_t)m_rows * ElemSize(col.type));
+
+    Put<uint32_t>(m_out, BLOCK_MAGIC);
+    Put<uint32_t>(m_out, m_rows);
+    Put<uint64_t>(m_out, payload);
+    for (size_t c = 0; c < cols.size(); ++c) {
+        size_t bytes = (size_t)m_rows * ElemSize(cols[c].type);
+        m_out.write(m_column_data[c].data(), bytes);
+        PutZeros(m_out, PadTo8(bytes) - bytes);
+    }
+    m_rows = 0;
+}
+
+ColumnarTelemetryWriter::Encoding ColumnarTelemetryWriter::EncodeColumn(size_t c) {
+    const ColumnType type = Columns()[c].type;
+    const size_t n = m_rows, sz = ElemSize(type);
+    const char* src = m_column_data[c].data();
+    unsigned char* dst = m_encoded.data();
+
+    if (type == COL_U8) {
+        memcpy(dst, src, n);
+        return ENC_RAW;
+    }
+    // Byte k della riga i in dst[k * n + i], dopo XOR (double) o differenza (interi) con la riga
+    // precedente. La trasposizione procede per byte k: scritture sequenziali su dst
+    if (type == COL_F64) {
+        // Precisione ridotta (mantissa_bits < 52): arrotondamento al valore piu' vicino, il tempo resta esatto
+        if (m_mantissa_bits < FULL_MANTISSA_BITS && c != 0) {
+            uint64_t* w = reinterpret_cast<uint64_t*>(m_column_data[c].data());
+            const uint32_t drop = FULL_MANTISSA_BITS - m_mantissa_bits;
+            const uint64_t half = 1ull << (drop - 1), mask = ~((1ull << drop) - 1);
+            for (size_t i = 0; i < n; ++i) {
+                if (((w[i] >> 52) & 0x7FF) != 0x7FF) w[i] = (w[i] + half) & mask;   // inf e NaN intatti
+            }
+        }
+        const uint64_t* v = reinterpret_cast<const uint64_t*>(src);
+        for (size_t k = 0; k < 8; ++k) {
+            unsigned char* out = dst + k * n;
+            out[0] = (unsigned char)(v[0] >> (8 * k));
+            for (size_t i = 1; i < n; ++i) out[i] = (unsigned char)((v[i] ^ v[i - 1]) >> (8 * k));
+        }
+        return ENC_XOR_SHUFFLE;
+    }
+    const uint32_t* v = reinterpret_cast<const uint32_t*>(src);
+    for (size_t k = 0; k < sz; ++k) {
+        unsigned char* out = dst + k * n;
+        out[0] = (unsigned char)(v[0] >> (8 * k));
+        for (size_t i = 1; i < n; ++i) out[i] = (unsigned char)((v[i] - v[i - 1]) >> (8 * k));
+    }
+    return ENC_DELTA_SHUFFLE;
+}
+
+void ColumnarTelemetryWriter::WriteCompressedBlock() {
+    const auto& cols = Columns();
+    vector<uint32_t>& encodings = m_encodings;
+    vector<uint32_t>& stored = m_stored;
+    uint64_t payload = 2 * sizeof(double) + cols.size() * 2 * sizeof(uint32_t);
+    for (size_t c = 0; c < cols.size(); ++c) {
+        encodings[c] = EncodeColumn(c);
+        deflateReset(&m_zstream);
+        m_zstream.next_in = m_encoded.data();
+        m_zstream.avail_in = (uInt)((size_t)m_rows * ElemSize(cols[c].type));
+        m_zstream.next_out = m_compressed[c].data();
+        m_zstream.avail_out = (uInt)m_compressed[c].size();
+        if (deflate(&m_zstream, Z_FINISH) != Z_STREAM_END) {
+            // deflateBound garantisce lo spazio: qui solo per un errore interno di zlib
+            m_out.setstate(ios::badbit);
+            m_rows = 0;
+            return;
+        }
+        stored[c] = (uint32_t)m_zstream.total_out;
+        payload += PadTo8(stored[c]);
+    }
+
+    // La colonna 0 e' time
+    const double* time = reinterpret_cast<const double*>(m_column_data[0].data());
+    double t_min = time[0], t_max = time[0];
+    for (uint32_t i = 1; i < m_rows; ++i) {
+        t_min = std::min(t_min, time[i]);
+        t_max = std::max(t_max, time[i]);
+    }
+    m_index.push_back({t_min, t_max, (uint64_t)m_out.tellp(), m_rows});
+
+    Put<uint32_t>(m_out, COMPRESSED_BLOCK_MAGIC);
+    Put<uint32_t>(m_out, m_rows);
+    Put<uint64_t>(m_out, payload);
+    Put<double>(m_out, t_min);
+    Put<double>(m_out, t_max);
+    for (size_t c = 0; c < cols.size(); ++c) {
+        Put<uint32_t>(m_out, encodings[c]);
+        Put<uint32_t>(m_out, stored[c]);
+    }
+    for (size_t c = 0; c < cols.size(); ++c) {
+        m_out.write(reinterpret_cast<const char*>(m_compressed[c].data()), stored[c]);
+        PutZeros(m_out, PadTo8(stored[c]) - stored[c]);
+    }
+    m_rows = 0;
+}
+
+void ColumnarTelemetryWriter::WriteIndex() {
+    if (!m_out.is_open()) return;
+    uint64_t index_offset = (uint64_t)m_out.tellp();
+    for (const BlockIndexEntry& e : m_index) {
+        Put<double>(m_out, e.t_min);
+        Put<double>(m_out, e.t_max);
+        Put<uint64_t>(m_out, e.offset);
+        Put<uint32_t>(m_out, e.num_rows);
+        Put<uint32_t>(m_out, 0);
+    }
+    Put<uint32_t>(m_out, INDEX_MAGIC);
+    Put<uint32_t>(m_out, (uint32_t)m_index.size());
+    Put<uint64_t>(m_out, index_offset);
+    m_out.flush();
+}
+
+void ColumnarTelemetryWriter::Flush() {
+    WriteBlock();
+    m_out.flush();
+}
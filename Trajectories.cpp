@@ -1,6 +1,5 @@
 #include "Trajectories.h"
 #include <cmath>
-#include <iostream>
 
 using namespace Eigen;
 using namespace std;
@@ -9,123 +8,157 @@ using namespace std;
 #define M_PI 3.14159265358979323846
 #endif
 
-// 1 = ATOMIC SHELL
-// 2 = CIRCULAR PATROL
-// 3 = OCTAHEDRON SWARM
-const int SCENARIO_TYPE = 3; 
-
-const double RADIUS = 80.0;              
-const double SPEED_FACTOR = 1.0;         
+const double RADIUS = 80.0;
+const double SPEED_FACTOR = 1.0;
 
 const Vector3d INITIAL_CENTER(100.0, 0.0, 50.0);
-const Vector3d SWARM_VELOCITY(2.5, 0.0, 0.0); 
-Vector3d GetCurrentCenter(double t) {
-    return INITIAL_CENTER + (SWARM_VELOCITY * t);
-}
-
-TrajectoryFunc MakeAtomicShell(int id, int total) {
-    double inclination = 0.0;
-    if (id % 3 == 0) inclination = 0.0;          
-    else if (id % 3 == 1) inclination = M_PI/2;  
-    else inclination = M_PI/4;                   
+const Vector3d SWARM_VELOCITY(2.5, 0.0, 0.0);
 
-    double phase_offset = (id * 2.0 * M_PI) / total;
+bool ParseFormation(const string& name, FormationType& out) {
+    if (name == "atomic_shell")    { out = FORMATION_ATOMIC_SHELL; return true; }
+    if (name == "circular_patrol") { out = FORMATION_CIRCULAR_PATROL; return true; }
+    if (name == "octahedron")      { out = FORMATION_OCTAHEDRON; return true; }
+    return false;
+}
 
-    return [inclination, phase_offset](double t) -> Vector3d {
-        Vector3d center = GetCurrentCenter(t);
+TrajectoryTable::TrajectoryTable() : m_center0(Vector3d::Zero()), m_velocity(Vector3d::Zero()) {}
+
+void TrajectoryTable::Clear() {
+    m_groups.clear();
+    m_drone_id.clear();
+    m_cos_phase.clear();
+    m_sin_phase.clear();
+    m_cos_phase2.clear();
+    m_sin_phase2.clear();
+    for (int a = 0; a < 3; ++a) {
+        m_offset[a].clear();
+        m_amp_cos[a].clear();
+        m_amp_sin[a].clear();
+        m_amp_bob[a].clear();
+    }
+}
 
-        double omega = ((2.0 * M_PI) / 50.0) * SPEED_FACTOR;
-        double angle = omega * t + phase_offset;
+void TrajectoryTable::SetCenterMotion(const Vector3d& center0, const Vector3d& velocity) {
+    m_center0 = center0;
+    m_velocity = velocity;
+}
 
-        double base_x = RADIUS * cos(angle);
-        double base_y = RADIUS * sin(angle);
-        double base_z = 0.0;
-        double x = base_x;
-        double y = base_y * cos(inclination) - base_z * sin(inclination);
-        double z = base_y * sin(inclination) + base_z * cos(inclination);
+void TrajectoryTable::BeginGroup(double omega, double omega2) {
+    int rows = GetNumRows();
+    m_groups.push_back({rows, rows, omega, omega2});
+}
 
-        if (inclination == 0.0) z += 15.0 * sin(angle * 2.0); 
+void TrajectoryTable::AddRow(int drone_id, double phase, double phase2, const Vector3d& offset,
+                             const Vector3d& amp_cos, const Vector3d& amp_sin, const Vector3d& amp_bob) {
+    if (m_groups.empty()) BeginGroup(0.0, 0.0);
+    m_drone_id.push_back(drone_id);
+    m_cos_phase.push_back(std::cos(phase));
+    m_sin_phase.push_back(std::sin(phase));
+    m_cos_phase2.push_back(std::cos(phase2));
+    m_sin_phase2.push_back(std::sin(phase2));
+    for (int a = 0; a < 3; ++a) {
+        m_offset[a].push_back(offset(a));
+        m_amp_cos[a].push_back(amp_cos(a));
+        m_amp_sin[a].push_back(amp_sin(a));
+        m_amp_bob[a].push_back(amp_bob(a));
+    }
+    m_groups.back().end = GetNumRows();
+}
 
-        return Vector3d(center.x() + x, center.y() + y, center.z() + z);
-    };
+void TrajectoryTable::Evaluate(double t, double* x, double* y, double* z) const {
+    const Vector3d center = m_center0 + m_velocity * t;
+    double* out[3] = {x, y, z};
+
+    for (const Group& g : m_groups) {
+        const double sa = std::sin(g.omega * t), ca = std::cos(g.omega * t);
+        const double sb = std::sin(g.omega2 * t), cb = std::cos(g.omega2 * t);
+        const double* cp = m_cos_phase.data();
+        const double* sp = m_sin_phase.data();
+        const double* cp2 = m_cos_phase2.data();
+        const double* sp2 = m_sin_phase2.data();
+
+        for (int a = 0; a < 3; ++a) {
+            const double c0 = center(a);
+            const double* off = m_offset[a].data();
+            const double* kc = m_amp_cos[a].data();
+            const double* ks = m_amp_sin[a].data();
+            const double* kb = m_amp_bob[a].data();
+            double* o = out[a];
+            for (int r = g.begin; r < g.end; ++r) {
+                double cos_a = ca * cp[r] - sa * sp[r];
+                double sin_a = sa * cp[r] + ca * sp[r];
+                double sin_b = sb * cp2[r] + cb * sp2[r];
+                o[r] = c0 + off[r] + kc[r] * cos_a + ks[r] * sin_a + kb[r] * sin_b;
+            }
+        }
+    }
 }
 
-TrajectoryFunc MakeCircularPatrol(int id, int total) {
-    double angle_step = (2.0 * M_PI) / (double)(total - 1);
-    double start_angle = (id - 1) * angle_step;
+namespace {
 
-    return [start_angle, id](double t) -> Vector3d {
-        Vector3d center = GetCurrentCenter(t);
+const Vector3d ZERO(0.0, 0.0, 0.0);
 
-        double omega = ((2.0 * M_PI) / 60.0) * SPEED_FACTOR;
-        double current_angle = start_angle + (omega * t);
+void AddAtomicShellRow(TrajectoryTable& table, int id, int total) {
+    double inclination = 0.0;
+    if (id % 3 == 0) inclination = 0.0;
+    else if (id % 3 == 1) inclination = M_PI/2;
+    else inclination = M_PI/4;
 
-        double x = center.x() + RADIUS * cos(current_angle);
-        double y = center.y() + RADIUS * sin(current_angle);
-        double z = center.z() + ((id % 2 == 0) ? 15.0 : -15.0); 
+    double phase_offset = (id * 2.0 * M_PI) / total;
+    Vector3d amp_sin(0.0, RADIUS * cos(inclination), RADIUS * sin(inclination));
+    // Solo l'anello equatoriale oscilla in quota, a frequenza doppia dell'orbita
+    Vector3d bob = inclination == 0.0 ? Vector3d(0.0, 0.0, 15.0) : ZERO;
+    table.AddRow(id, phase_offset, 2.0 * phase_offset, ZERO, Vector3d(RADIUS, 0, 0), amp_sin, bob);
+}
 
-        return Vector3d(x, y, z);
-    };
+void AddCircularPatrolRow(TrajectoryTable& table, int id, int total) {
+    double angle_step = (2.0 * M_PI) / (double)(total - 1);
+    double start_angle = (id - 1) * angle_step;
+    Vector3d offset(0.0, 0.0, (id % 2 == 0) ? 15.0 : -15.0);
+    table.AddRow(id, start_angle, 0.0, offset, Vector3d(RADIUS, 0, 0), Vector3d(0, RADIUS, 0), ZERO);
 }
 
-TrajectoryFunc MakeOctahedronFormation(int id) {
-    return [id](double t) -> Vector3d {
-        Vector3d center = GetCurrentCenter(t);
-
-        double omega = 0.2 * SPEED_FACTOR; 
-        double theta = omega * t;
-        double local_x = 0, local_y = 0, local_z = 0;
-        switch(id % 6) { 
-            case 0: local_z = RADIUS; break;  
-            case 1: local_z = -RADIUS; break; 
-            case 2: 
-                local_x = RADIUS * cos(theta); 
-                local_y = RADIUS * sin(theta); 
-                break;
-            case 3: 
-                local_x = RADIUS * cos(theta + M_PI/2); 
-                local_y = RADIUS * sin(theta + M_PI/2); 
-                break;
-            case 4: 
-                local_x = RADIUS * cos(theta + M_PI); 
-                local_y = RADIUS * sin(theta + M_PI); 
-                break;
-            case 5: 
-                local_x = RADIUS * cos(theta + 3*M_PI/2); 
-                local_y = RADIUS * sin(theta + 3*M_PI/2); 
-                break;
-        }
-        if (id >= 2) local_z += 10.0 * sin(t * 0.5 + id);
-        return Vector3d(center.x() + local_x, center.y() + local_y, center.z() + local_z);
-    };
+void AddOctahedronRow(TrajectoryTable& table, int id) {
+    // Vertici 0/1: poli fissi; 2..5: quadrato equatoriale che ruota, sfasato di 90 gradi
+    Vector3d offset = ZERO, amp_cos = ZERO, amp_sin = ZERO;
+    double phase = 0.0;
+    switch (id % 6) {
+        case 0: offset.z() = RADIUS; break;
+        case 1: offset.z() = -RADIUS; break;
+        default:
+            amp_cos.x() = RADIUS;
+            amp_sin.y() = RADIUS;
+            phase = (id % 6 - 2) * M_PI / 2;
+            break;
+    }
+    Vector3d bob = id >= 2 ? Vector3d(0.0, 0.0, 10.0) : ZERO;
+    table.AddRow(id, phase, (double)id, offset, amp_cos, amp_sin, bob);
 }
 
-TrajectoryFunc MakeFigureEightTarget() {
-    return [](double t) -> Vector3d {
-        Vector3d center = GetCurrentCenter(t);
-        double omega = ((2.0 * M_PI) / 40.0) * SPEED_FACTOR;
-        double x = 70.0 * sin(omega * t);
-        double y = 30.0 * sin(2.0 * omega * t);
-        double z = 10.0 * cos(omega * t);
-        
-        return Vector3d(center.x() + x, center.y() + y, center.z() + z);
-    };
 }
 
-TrajectoryFunc GetAnchorTrajectory(int id, int total) {
-    if (SCENARIO_TYPE == 3) {
-        return MakeOctahedronFormation(id); 
-    } else if (SCENARIO_TYPE == 2) {
-        return MakeCircularPatrol(id, total);
-    } else {
-        return MakeAtomicShell(id, total); 
+TrajectoryTable BuildSwarmFormation(FormationType formation, int num_drones) {
+    TrajectoryTable table;
+    table.SetCenterMotion(INITIAL_CENTER, SWARM_VELOCITY);
+
+    if (formation == FORMATION_OCTAHEDRON) {
+        table.BeginGroup(0.2 * SPEED_FACTOR, 0.5);
+        for (int id = 0; id < num_drones; ++id) AddOctahedronRow(table, id);
+        return table;
     }
-}
 
-TrajectoryFunc GetTargetTrajectory() {
-    if (SCENARIO_TYPE == 3) {
-        return MakeOctahedronFormation(0); 
+    // Target a figura a otto: x = 70 sin(wt), y = 30 sin(2wt), z = 10 cos(wt)
+    double omega_target = ((2.0 * M_PI) / 40.0) * SPEED_FACTOR;
+    table.BeginGroup(omega_target, 2.0 * omega_target);
+    table.AddRow(0, 0.0, 0.0, ZERO, Vector3d(0, 0, 10.0), Vector3d(70.0, 0, 0), Vector3d(0, 30.0, 0));
+
+    if (formation == FORMATION_CIRCULAR_PATROL) {
+        table.BeginGroup(((2.0 * M_PI) / 60.0) * SPEED_FACTOR, 0.0);
+        for (int id = 1; id < num_drones; ++id) AddCircularPatrolRow(table, id, num_drones);
     } else {
-        return MakeFigureEightTarget();
+        double omega = ((2.0 * M_PI) / 50.0) * SPEED_FACTOR;
+        table.BeginGroup(omega, 2.0 * omega);
+        for (int id = 1; id < num_drones; ++id) AddAtomicShellRow(table, id, num_drones);
     }
+    return table;
 }
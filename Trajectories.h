@@ -3,10 +3,66 @@
 
 #include <Eigen/Dense>
 #include <functional>
+#include <string>
+#include <vector>
 
 using TrajectoryFunc = std::function<Eigen::Vector3d(double)>;
 
-TrajectoryFunc GetAnchorTrajectory(int id, int total_anchors);
-TrajectoryFunc GetTargetTrajectory();
+// Stessa numerazione del vecchio SCENARIO_TYPE
+enum FormationType {
+    FORMATION_ATOMIC_SHELL = 1,
+    FORMATION_CIRCULAR_PATROL = 2,
+    FORMATION_OCTAHEDRON = 3
+};
+
+// "atomic_shell", "circular_patrol", "octahedron"
+bool ParseFormation(const std::string& name, FormationType& out);
+
+/**
+ * Leggi di moto dello sciame come tabella di parametri, una riga per drone:
+ *
+ *     pos(t) = c0 + v t + offset + amp_cos cos(a) + amp_sin sin(a) + amp_bob sin(b)
+ *     a = omega t + phase,   b = omega2 t + phase2
+ *
+ * Un'orbita circolare di raggio R inclinata di 'inc' sull'asse x ha amp_cos = (R, 0, 0) e
+ * amp_sin = (0, R cos inc, R sin inc); il termine 'bob' e' l'oscillazione verticale.
+ * Le righe sono raggruppate per (omega, omega2): Evaluate calcola sin/cos una volta per
+ * gruppo e per ogni riga resta solo aritmetica (somma di angoli con sin/cos della fase
+ * precalcolati), in loop senza salti su array contigui che il compilatore vettorializza.
+ */
+class TrajectoryTable {
+public:
+    TrajectoryTable();
+
+    void Clear();
+    void SetCenterMotion(const Eigen::Vector3d& center0, const Eigen::Vector3d& velocity);
+
+    // Le righe aggiunte dopo BeginGroup condividono omega e omega2
+    void BeginGroup(double omega, double omega2);
+    void AddRow(int drone_id, double phase, double phase2, const Eigen::Vector3d& offset,
+                const Eigen::Vector3d& amp_cos, const Eigen::Vector3d& amp_sin, const Eigen::Vector3d& amp_bob);
+
+    int GetNumRows() const { return (int)m_drone_id.size(); }
+    int GetDroneId(int row) const { return m_drone_id[row]; }
+
+    // Posizioni di tutte le righe al tempo t, in ordine di riga
+    void Evaluate(double t, double* x, double* y, double* z) const;
+
+private:
+    struct Group {
+        int begin, end;
+        double omega, omega2;
+    };
+
+    Eigen::Vector3d m_center0;
+    Eigen::Vector3d m_velocity;
+    std::vector<Group> m_groups;
+    std::vector<int> m_drone_id;
+    std::vector<double> m_cos_phase, m_sin_phase, m_cos_phase2, m_sin_phase2;
+    std::vector<double> m_offset[3], m_amp_cos[3], m_amp_sin[3], m_amp_bob[3];
+};
+
+// Drone 0 e' il target (figura a otto, o vertice dell'ottaedro), gli altri seguono la formazione
+TrajectoryTable BuildSwarmFormation(FormationType formation, int num_drones);
 
 #endif
@@ -0,0 +1,48 @@
+#include "TransmitterColoring.h"
+
+using namespace std;
+
+void TransmitterColoring::Build(int num_nodes, const vector<int>& rx_start, const vector<int>& rx_ids) {
+    // CSR inverso (counting sort): m_heard_ids[m_heard_start[d] ..] sono i trasmettitori che raggiungono d
+    m_heard_start.assign(num_nodes + 1, 0);
+    for (int v = 0; v < num_nodes; ++v)
+        for (int k = rx_start[v]; k < rx_start[v + 1]; ++k) m_heard_start[rx_ids[k] + 1]++;
+    for (int d = 0; d < num_nodes; ++d) m_heard_start[d + 1] += m_heard_start[d];
+    m_heard_ids.resize(m_heard_start[num_nodes]);
+    m_fill.assign(num_nodes, 0);
+    for (int v = 0; v < num_nodes; ++v)
+        for (int k = rx_start[v]; k < rx_start[v + 1]; ++k) {
+            int d = rx_ids[k];
+            m_heard_ids[m_heard_start[d] + m_fill[d]++] = v;
+        }
+
+    m_color.assign(num_nodes, -1);
+    m_forbidden.assign(num_nodes, -1);
+    m_num_groups = 0;
+    auto forbid_clique = [&](int d, int v) {
+        if (d != v && m_color[d] >= 0) m_forbidden[m_color[d]] = v;
+        for (int k = m_heard_start[d]; k < m_heard_start[d + 1]; ++k) {
+            int t = m_heard_ids[k];
+            if (t != v && m_color[t] >= 0) m_forbidden[m_color[t]] = v;
+        }
+    };
+    for (int v = 0; v < num_nodes; ++v) {
+        forbid_clique(v, v);
+        for (int k = rx_start[v]; k < rx_start[v + 1]; ++k) forbid_clique(rx_ids[k], v);
+        int c = 0;
+        while (m_forbidden[c] == v) ++c;
+        m_color[v] = c;
+        if (c + 1 > m_num_groups) m_num_groups = c + 1;
+    }
+
+    // Gruppi per colore, id crescenti dentro ogni gruppo
+    m_group_start.assign(m_num_groups + 1, 0);
+    for (int v = 0; v < num_nodes; ++v) m_group_start[m_color[v] + 1]++;
+    for (int g = 0; g < m_num_groups; ++g) m_group_start[g + 1] += m_group_start[g];
+    m_group_ids.resize(num_nodes);
+    m_fill.assign(m_num_groups, 0);
+    for (int v = 0; v < num_nodes; ++v) {
+        int g = m_color[v];
+        m_group_ids[m_group_start[g] + m_fill[g]++] = v;
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef TRANSMITTER_COLORING_H
+#define TRANSMITTER_COLORING_H
+
+#include <vector>
+
+using namespace std;
+
+/**
+ * Assegnazione dei trasmettitori agli slot per il riuso spaziale del TDMA.
+ *
+ * Ogni drone v ha un insieme di ricevitori Rx(v). Due trasmettitori u, v sono in conflitto
+ * (non possono condividere uno slot) se un ricevitore li sente entrambi (Rx(u) e Rx(v) si
+ * intersecano) o se uno dei due e' ricevitore dell'altro (un drone non trasmette e riceve
+ * insieme). Build colora il grafo dei conflitti in modo greedy, per id crescente: ogni colore
+ * e' un gruppo di trasmettitori che possono usare lo stesso slot.
+ *
+ * Gli archi non vengono mai materializzati: per ogni drone d i trasmettitori che lo
+ * raggiungono, piu' d stesso, formano una clique, e i vicini di v sono l'unione delle clique
+ * dei droni in {v} + Rx(v). Costo O(N k^2) con k ricevitori per drone; i buffer sono membri,
+ * quindi una ricolorazione a regime non alloca.
+ */
+class TransmitterColoring {
+public:
+    // Ricevitori in formato CSR: quelli di v sono rx_ids[rx_start[v] .. rx_start[v+1])
+    void Build(int num_nodes, const vector<int>& rx_start, const vector<int>& rx_ids);
+
+    int GetNumGroups() const { return m_num_groups; }
+    // Trasmettitori del gruppo g, id crescenti
+    const int* GroupBegin(int g) const { return m_group_ids.data() + m_group_start[g]; }
+    const int* GroupEnd(int g) const { return m_group_ids.data() + m_group_start[g + 1]; }
+    int GetGroupOf(int node) const { return m_color[node]; }
+
+private:
+    int m_num_groups = 0;
+    vector<int> m_color;
+    vector<int> m_heard_start, m_heard_ids;   // CSR inverso: trasmettitori che raggiungono d
+    vector<int> m_forbidden;                  // m_forbidden[c] == v: colore c vietato per v
+    vector<int> m_group_start, m_group_ids;
+    vector<int> m_fill;                       // cursori dei counting sort
+};
+
+#endif
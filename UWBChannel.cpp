@@ -1,99 +1,151 @@
 #include "UWBChannel.h"
 #include <cmath>
+#include <algorithm>
 
-using namespace ns3;
 using namespace Eigen;
 using namespace std;
 
-TypeId UWBChannel::GetTypeId()
-{
-    static TypeId tid = TypeId("UWBChannel")
-        .SetParent<Object>()
-        .SetGroupName("UWB-Localization");
-    return tid;
-}
-
 UWBChannel::UWBChannel()
-    : m_environment("outdoor")
+    : m_obstacles_dirty(false)
 {
+    SetEnvironment(ENV_OUTDOOR);
     std::random_device rd;
     m_rng.seed(rd());
 }
 
 UWBChannel::~UWBChannel() {}
 
-void UWBChannel::SetEnvironment(std::string env_type) { m_environment = env_type; }
+void UWBChannel::SetEnvironment(std::string env_type)
+{
+    if (env_type == "outdoor") SetEnvironment(ENV_OUTDOOR);
+    else if (env_type == "indoor") SetEnvironment(ENV_INDOOR);
+    else SetEnvironment(ENV_MIXED);
+}
 
-bool UWBChannel::DetermineLOS(Vector3d tx, Vector3d rx) 
+void UWBChannel::SetEnvironment(Environment env)
 {
-    double total_distance = (rx - tx).norm();
-    double distance = total_distance;
-    double p_los;
-    
-    if (m_environment == "outdoor") {
-        p_los = std::exp(-distance / 500.0); 
-    } else if (m_environment == "indoor") {
-        p_los = std::exp(-distance / 30.0);
-    } else {
-        p_los = std::exp(-distance / 150.0);
+    m_environment = env;
+    switch (env) {
+        case ENV_OUTDOOR: m_params = {500.0,  5.0, 10.0, 15.0, 0.1}; break;
+        case ENV_INDOOR:  m_params = { 30.0, 10.0, 15.0, 25.0, 0.3}; break;
+        default:          m_params = {150.0, 10.0, 15.0, 25.0, 0.3}; break;
     }
-    
-    std::uniform_real_distribution<double> uniform(0.0, 1.0);
-    return uniform(m_rng) < p_los;
 }
 
-double UWBChannel::ComputePathLoss(double distance_m, bool is_los) 
+void UWBChannel::SetSeed(uint32_t seed)
+{
+    m_rng.seed(seed);
+    m_rx_rng.clear();
+}
+
+void UWBChannel::AddObstacle(Vector3d center, double radius)
+{
+    std::lock_guard<std::mutex> lock(m_obstacles_mutex);
+    m_obstacles.push_back({center, radius});
+    m_obstacles_dirty.store(true, std::memory_order_release);
+}
+
+// Ricostruzione pigra: piu' thread possono valutare link insieme, solo il primo ricostruisce
+const ObstacleBVH& UWBChannel::GetObstacleIndex()
 {
-    double freq_ghz = 6.5;
-    double fspl_db = 20 * std::log10(distance_m) + 
-                     20 * std::log10(freq_ghz) + 
-                     92.45;
-    
-    if (is_los) {
-        std::normal_distribution<double> shadow_fading(0.0, 3.0);
-        return fspl_db + shadow_fading(m_rng);
-    } else {
-        double excess_pl = 0.0;
-        if (m_environment == "outdoor") {
-            excess_pl = 5.0 + 10 * std::log10(distance_m / 10.0);
-        } else {
-            excess_pl = 10.0 + 15 * std::log10(distance_m / 10.0);
+    if (m_obstacles_dirty.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(m_obstacles_mutex);
+        if (m_obstacles_dirty.load(std::memory_order_relaxed)) {
+            m_obstacle_bvh.Build(m_obstacles);
+            m_obstacles_dirty.store(false, std::memory_order_release);
         }
-        
-        std::normal_distribution<double> shadow_fading(0.0, 6.0); 
-        return fspl_db + excess_pl + shadow_fading(m_rng);
     }
+    return m_obstacle_bvh;
 }
 
-double UWBChannel::ComputeDelaySpread(double distance_m, bool is_los) 
+void UWBChannel::SetNumReceivers(uint32_t num_receivers)
 {
-    if (is_los) {
-        return 5.0 + distance_m * 0.02;
-    } else {
-        if (m_environment == "outdoor") {
-            return 15.0 + distance_m * 0.1;
-        } else {
-            return 25.0 + distance_m * 0.3;
-        }
+    // Aggiunge solo i generatori mancanti: quelli esistenti mantengono il loro stato
+    for (uint32_t i = m_rx_rng.size(); i < num_receivers; ++i) {
+        std::seed_seq seq{(uint32_t)m_rng(), (uint32_t)m_rng(), i};
+        m_rx_rng.emplace_back(seq);
     }
 }
 
-double UWBChannel::ComputeRangingError(bool is_los, double distance_m) 
+// Blocco di link valutati insieme: array locali, un elemento per link
+struct UWBChannel::LinkChunk {
+    static const int SIZE = 64;
+    uint8_t blocked[SIZE];
+    uint8_t is_los[SIZE];
+    double distance[SIZE];
+    double p_los[SIZE];
+    double z_shadow[SIZE];     // normale standard del shadow fading
+    double z_ranging[SIZE];    // normale standard dell'errore di ranging
+    double nlos_bias[SIZE];
+    double path_loss_db[SIZE];
+    double delay_spread_ns[SIZE];
+    double rssi_dbm[SIZE];
+    double ranging_error_m[SIZE];
+};
+
+namespace {
+
+const double FREQ_GHZ = 6.5;
+const double LOS_SHADOW_DB = 3.0;
+const double NLOS_SHADOW_DB = 6.0;
+const double LOS_RANGING_SIGMA_M = 0.10;
+const double NLOS_RANGING_SIGMA_M = 0.50;
+
+}
+
+/*
+ * Tre passate sul blocco:
+ *  1. geometria (distanze, probabilita' di LOS) e ostacoli, senza dipendenze tra link;
+ *  2. estrazioni casuali, l'unica parte sequenziale: ogni link usa il proprio generatore
+ *     sempre nello stesso ordine (LOS, bias NLOS, coppia di normali);
+ *  3. path loss, delay spread ed errore di ranging senza salti, in loop vettorializzabili.
+ */
+template <class RngOf>
+void UWBChannel::EvaluateChunk(const Vector3d& tx_pos, const Vector3d* rx_pos, int count, double tx_power_dbm,
+                               RngOf&& rng_of, LinkChunk& c)
 {
-    double base_error;
-    
-    if (is_los) {
-        std::normal_distribution<double> los_error(0.0, 0.10); 
-        base_error = los_error(m_rng);
-    } else {
-        std::normal_distribution<double> nlos_variance(0.0, 0.50); 
-        std::uniform_real_distribution<double> nlos_bias(0.3, 2.5); 
-        
-        base_error = nlos_bias(m_rng) + nlos_variance(m_rng);
+    const EnvironmentParams& env = m_params;
+
+    GetObstacleIndex().SegmentsBlocked(tx_pos, rx_pos, count, c.blocked);
+    for (int i = 0; i < count; ++i) c.distance[i] = (rx_pos[i] - tx_pos).norm();
+    for (int i = 0; i < count; ++i) c.p_los[i] = std::exp(-c.distance[i] / env.los_scale_m);
+
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::uniform_real_distribution<double> nlos_bias(0.3, 2.5);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    for (int i = 0; i < count; ++i) {
+        std::mt19937& rng = rng_of(i);
+        // L'estrazione del LOS avviene anche per i link ostruiti, cosi' la sequenza casuale
+        // del ricevitore non dipende dagli ostacoli
+        bool los = uniform(rng) < c.p_los[i];
+        los = los && !c.blocked[i];
+        c.is_los[i] = los ? 1 : 0;
+
+        c.nlos_bias[i] = los ? 0.0 : nlos_bias(rng);
+
+        // Le due normali del link sono la coppia di un'unica estrazione polare; reset() evita
+        // che il valore in cache passi al link successivo (e quindi a un altro generatore)
+        normal.reset();
+        c.z_shadow[i] = normal(rng);
+        c.z_ranging[i] = normal(rng);
+    }
+
+    const double fspl_freq_db = 20 * std::log10(FREQ_GHZ) + 92.45;
+    for (int i = 0; i < count; ++i) {
+        double d = c.distance[i];
+        double lg = std::log10(d);
+        double fspl_db = 20 * lg + fspl_freq_db;
+        double excess_db = env.nlos_excess_db + env.nlos_excess_slope_db * (lg - 1.0);
+        bool los = c.is_los[i] != 0;
+
+        double shadow_db = c.z_shadow[i] * (los ? LOS_SHADOW_DB : NLOS_SHADOW_DB);
+        c.path_loss_db[i] = fspl_db + (los ? 0.0 : excess_db) + shadow_db;
+        c.rssi_dbm[i] = tx_power_dbm - c.path_loss_db[i];
+        c.delay_spread_ns[i] = los ? 5.0 + d * 0.02 : env.nlos_spread_ns + d * env.nlos_spread_slope_ns;
+
+        double base_error = c.nlos_bias[i] + c.z_ranging[i] * (los ? LOS_RANGING_SIGMA_M : NLOS_RANGING_SIGMA_M);
+        c.ranging_error_m[i] = base_error * (1.0 + d / 200.0);
     }
-    
-    double distance_factor = 1.0 + (distance_m / 200.0);
-    return base_error * distance_factor;
 }
 
 ChannelCondition UWBChannel::ComputeChannelCondition(
@@ -101,14 +153,58 @@ ChannelCondition UWBChannel::ComputeChannelCondition(
     Vector3d rx_pos,
     double tx_power_dbm
 ) {
-    ChannelCondition cond;
-    double distance_m = (rx_pos - tx_pos).norm();
-    
-    cond.is_los = DetermineLOS(tx_pos, rx_pos);
-    cond.path_loss_db = ComputePathLoss(distance_m, cond.is_los);
-    cond.rssi_dbm = tx_power_dbm - cond.path_loss_db;
-    cond.delay_spread_ns = ComputeDelaySpread(distance_m, cond.is_los);
-    cond.ranging_error_m = ComputeRangingError(cond.is_los, distance_m);
-    
-    return cond;
+    LinkChunk c;
+    EvaluateChunk(tx_pos, &rx_pos, 1, tx_power_dbm, [this](int) -> std::mt19937& { return m_rng; }, c);
+    return {c.is_los[0] != 0, c.path_loss_db[0], c.delay_spread_ns[0], c.rssi_dbm[0], c.ranging_error_m[0]};
+}
+
+ChannelCondition UWBChannel::ComputeChannelCondition(
+    Vector3d tx_pos, 
+    Vector3d rx_pos,
+    double tx_power_dbm,
+    uint32_t rx_id
+) {
+    if (rx_id >= m_rx_rng.size()) SetNumReceivers(rx_id + 1);
+    LinkChunk c;
+    EvaluateChunk(tx_pos, &rx_pos, 1, tx_power_dbm, [this, rx_id](int) -> std::mt19937& { return m_rx_rng[rx_id]; }, c);
+    return {c.is_los[0] != 0, c.path_loss_db[0], c.delay_spread_ns[0], c.rssi_dbm[0], c.ranging_error_m[0]};
+}
+
+void UWBChannel::ComputeChannelConditions(
+    const Vector3d& tx_pos,
+    const Vector3d* rx_pos,
+    const int* rx_ids,
+    int begin,
+    int end,
+    double tx_power_dbm,
+    ChannelConditionBlock& out
+) {
+    LinkChunk c;
+    for (int b = begin; b < end; b += LinkChunk::SIZE) {
+        int count = std::min((int)LinkChunk::SIZE, end - b);
+        EvaluateChunk(tx_pos, rx_pos + b, count, tx_power_dbm,
+                      [this, rx_ids, b](int i) -> std::mt19937& { return m_rx_rng[rx_ids[b + i]]; }, c);
+        std::copy(c.is_los, c.is_los + count, out.is_los.begin() + b);
+        std::copy(c.path_loss_db, c.path_loss_db + count, out.path_loss_db.begin() + b);
+        std::copy(c.delay_spread_ns, c.delay_spread_ns + count, out.delay_spread_ns.begin() + b);
+        std::copy(c.rssi_dbm, c.rssi_dbm + count, out.rssi_dbm.begin() + b);
+        std::copy(c.ranging_error_m, c.ranging_error_m + count, out.ranging_error_m.begin() + b);
+    }
+}
+
+void UWBChannel::SaveState(CheckpointWriter& out) const
+{
+    out.PutEngine(m_rng);
+    out.Put<uint32_t>((uint32_t)m_rx_rng.size());
+    for (const auto& rng : m_rx_rng) out.PutEngine(rng);
+}
+
+bool UWBChannel::LoadState(CheckpointReader& in)
+{
+    in.GetEngine(m_rng);
+    uint32_t n = in.Get<uint32_t>();
+    if (!in.Ok()) return false;
+    m_rx_rng.resize(n);
+    for (auto& rng : m_rx_rng) in.GetEngine(rng);
+    return in.Ok();
 }
@@ -1,14 +1,16 @@
 #ifndef UWB_CHANNEL_H
 #define UWB_CHANNEL_H
 
-#include "ns3/core-module.h"
 #include "UWBMessage.h"
+#include "ObstacleBVH.h"
+#include "Checkpoint.h"
 #include <Eigen/Dense>
 #include <random>
 #include <vector>
 #include <cstdint>
+#include <atomic>
+#include <mutex>
 
-using namespace ns3;
 using namespace Eigen;
 
 struct ChannelCondition {
@@ -19,11 +21,32 @@ struct ChannelCondition {
     double ranging_error_m;   
 };
 
-class UWBChannel : public Object
+// Condizioni di n link in Structure-of-Arrays (vedi UWBChannel::ComputeChannelConditions)
+struct ChannelConditionBlock {
+    std::vector<uint8_t> is_los;
+    std::vector<double> path_loss_db;
+    std::vector<double> delay_spread_ns;
+    std::vector<double> rssi_dbm;
+    std::vector<double> ranging_error_m;
+
+    void Resize(size_t n) {
+        is_los.resize(n);
+        path_loss_db.resize(n);
+        delay_spread_ns.resize(n);
+        rssi_dbm.resize(n);
+        ranging_error_m.resize(n);
+    }
+    size_t Size() const { return is_los.size(); }
+    ChannelCondition At(size_t i) const {
+        return {is_los[i] != 0, path_loss_db[i], delay_spread_ns[i], rssi_dbm[i], ranging_error_m[i]};
+    }
+};
+
+class UWBChannel
 {
 public:
-    static TypeId GetTypeId();
-    
+    enum Environment { ENV_OUTDOOR, ENV_INDOOR, ENV_MIXED };
+
     UWBChannel();
     virtual ~UWBChannel();
     
@@ -32,19 +55,70 @@ public:
         Vector3d rx_pos,
         double tx_power_dbm = 0.0
     );
+
+    // Come sopra ma con il generatore dedicato al ricevitore rx_id (vedi SetNumReceivers):
+    // l'esito non dipende dall'ordine in cui vengono valutati i link, quindi si puo'
+    // chiamare in parallelo per ricevitori diversi.
+    ChannelCondition ComputeChannelCondition(
+        Vector3d tx_pos, 
+        Vector3d rx_pos,
+        double tx_power_dbm,
+        uint32_t rx_id
+    );
     
+    // Link tx_pos -> rx_pos[i] per i in [begin, end), ciascuno con il generatore del ricevitore
+    // rx_ids[i]; i risultati vanno in out[i] (out gia' dimensionato). Stesso esito delle chiamate
+    // singole. Intervalli disgiunti si possono valutare in parallelo sullo stesso blocco.
+    void ComputeChannelConditions(
+        const Vector3d& tx_pos,
+        const Vector3d* rx_pos,
+        const int* rx_ids,
+        int begin,
+        int end,
+        double tx_power_dbm,
+        ChannelConditionBlock& out
+    );
+    
+    // "outdoor", "indoor", qualsiasi altro valore = ambiente misto
     void SetEnvironment(std::string env_type); 
+    void SetEnvironment(Environment env);
+    Environment GetEnvironment() const { return m_environment; }
+    void SetSeed(uint32_t seed);
+    // Un link che attraversa un ostacolo e' sempre NLOS. L'indice (BVH) viene ricostruito
+    // alla prima valutazione successiva all'aggiunta.
     void AddObstacle(Vector3d center, double radius); 
+    size_t GetNumObstacles() const { return m_obstacles.size(); }
+    // Un generatore indipendente per ricevitore; da chiamare prima di valutare link in parallelo
+    void SetNumReceivers(uint32_t num_receivers);
+
+    // Stato dei generatori; ambiente e ostacoli vengono dallo scenario
+    void SaveState(CheckpointWriter& out) const;
+    bool LoadState(CheckpointReader& in);
     
 private:
-    std::string m_environment;
-    std::vector<std::pair<Vector3d, double>> m_obstacles; 
+    // Costanti del modello per l'ambiente corrente, risolte una volta in SetEnvironment
+    struct EnvironmentParams {
+        double los_scale_m;        // p_los = exp(-d / los_scale_m)
+        double nlos_excess_db;     // perdita NLOS extra: a + b * log10(d / 10)
+        double nlos_excess_slope_db;
+        double nlos_spread_ns;     // delay spread NLOS: a + b * d
+        double nlos_spread_slope_ns;
+    };
+    struct LinkChunk;
+
+    Environment m_environment;
+    EnvironmentParams m_params;
+    std::vector<ObstacleBVH::Sphere> m_obstacles; 
+    ObstacleBVH m_obstacle_bvh;
+    std::atomic<bool> m_obstacles_dirty;
+    std::mutex m_obstacles_mutex;
     std::mt19937 m_rng;
+    std::vector<std::mt19937> m_rx_rng;
     
-    bool DetermineLOS(Vector3d tx, Vector3d rx);
-    double ComputePathLoss(double distance_m, bool is_los);
-    double ComputeDelaySpread(double distance_m, bool is_los);
-    double ComputeRangingError(bool is_los, double distance_m);
+    const ObstacleBVH& GetObstacleIndex();
+    template <class RngOf>
+    void EvaluateChunk(const Vector3d& tx_pos, const Vector3d* rx_pos, int count, double tx_power_dbm,
+                       RngOf&& rng_of, LinkChunk& out);
 };
 
 #endif
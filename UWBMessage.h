@@ -2,12 +2,15 @@
 #define UWBMESSAGE_H
 
 #include <Eigen/Dense> 
+#include "SwarmConsensus.h"
 
 struct UWBMessage {
     uint32_t sender_id;         
     uint64_t tx_timestamp_ps;
     Eigen::Vector3d gps_position;
-    uint32_t vote_bitmask;
+    double clock_offset;        // stima del mittente del proprio offset (ClockFilter), s
+    double clock_offset_var;    // e sua varianza (infinito se il clock del mittente non e' agganciato)
+    VoteBitset votes;           // bit i = fiducia nel GPS dichiarato dal drone i
 };
 
 struct RangingMeasurement {
@@ -0,0 +1,78 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+using namespace std;
+
+WorkerPool::WorkerPool(unsigned num_threads)
+    : m_job(nullptr), m_ctx(nullptr), m_n(0), m_grain(1), m_next(0),
+      m_busy_workers(0), m_generation(0), m_stop(false)
+{
+    for (unsigned i = 1; i < num_threads; ++i) {
+        m_threads.emplace_back(&WorkerPool::WorkerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv_start.notify_all();
+    for (auto& t : m_threads) t.join();
+}
+
+void WorkerPool::Run(int n, int grain, JobFn job, void* ctx) {
+    if (n <= 0) return;
+    grain = max(grain, 1);
+
+    // Niente da spartire: esegue direttamente sul thread chiamante
+    if (m_threads.empty() || n <= grain) {
+        for (int b = 0; b < n; b += grain) job(ctx, b, min(n, b + grain));
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_job = job;
+        m_ctx = ctx;
+        m_n = n;
+        m_grain = grain;
+        m_next.store(0, memory_order_relaxed);
+        m_busy_workers = m_threads.size();
+        ++m_generation;
+    }
+    m_cv_start.notify_all();
+
+    WorkChunks();
+
+    unique_lock<mutex> lock(m_mutex);
+    m_cv_done.wait(lock, [this] { return m_busy_workers == 0; });
+}
+
+void WorkerPool::WorkChunks() {
+    while (true) {
+        int begin = m_next.fetch_add(m_grain, memory_order_relaxed);
+        if (begin >= m_n) break;
+        m_job(m_ctx, begin, min(m_n, begin + m_grain));
+    }
+}
+
+void WorkerPool::WorkerLoop() {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_cv_start.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop) return;
+            seen = m_generation;
+        }
+
+        WorkChunks();
+
+        {
+            lock_guard<mutex> lock(m_mutex);
+            --m_busy_workers;
+        }
+        m_cv_done.notify_one();
+    }
+}
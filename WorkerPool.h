@@ -0,0 +1,56 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Pool di thread persistente per il fork-join dentro uno slot TDMA.
+ * ParallelFor divide [0, n) in blocchi di 'grain' elementi, li distribuisce ai worker
+ * (il thread chiamante partecipa) e ritorna solo quando tutti i blocchi sono finiti.
+ * I thread restano vivi tra uno slot e l'altro: nessuna creazione di thread nel loop.
+ */
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned num_threads);
+    ~WorkerPool();
+
+    unsigned GetNumThreads() const { return m_threads.size() + 1; }
+
+    // fn(begin, end) viene chiamata su blocchi disgiunti che coprono [0, n)
+    template <class F>
+    void ParallelFor(int n, int grain, F&& fn) {
+        Run(n, grain, &Invoke<typename std::remove_reference<F>::type>, (void*)&fn);
+    }
+
+private:
+    typedef void (*JobFn)(void* ctx, int begin, int end);
+
+    template <class F>
+    static void Invoke(void* ctx, int begin, int end) { (*static_cast<F*>(ctx))(begin, end); }
+
+    void Run(int n, int grain, JobFn job, void* ctx);
+    void WorkChunks();
+    void WorkerLoop();
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_cv_start;
+    std::condition_variable m_cv_done;
+
+    JobFn m_job;
+    void* m_ctx;
+    int m_n;
+    int m_grain;
+    std::atomic<int> m_next;
+    int m_busy_workers;
+    uint64_t m_generation;
+    bool m_stop;
+};
+
+#endif
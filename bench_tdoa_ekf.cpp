@@ -0,0 +1,92 @@
+/**
+ * Benchmark TDoAEKF (matrici dinamiche) vs FixedTDoAEKF (dimensione fissa, senza heap).
+ *
+ * Per ogni numero di ancore simula un target in moto e misura il tempo medio di un
+ * ciclo Predict + Update per i due filtri, alimentati con le stesse misure.
+ * Riporta anche lo scarto massimo tra le due stime di posizione, che deve restare
+ * a livello di errore numerico.
+ *
+ * Uso: ./bench_tdoa_ekf [iterazioni]
+ */
+
+#include "TDoAEKF.h"
+#include "FixedTDoAEKF.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace Eigen;
+using namespace std;
+
+static const double C_LIGHT = 299792458.0;
+
+struct Scenario {
+    vector<vector<TDoAEKF::Msmnt>> steps;
+    Vector3d start;
+};
+
+static Scenario BuildScenario(int num_anchors, int num_steps, double dt, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> noise(0.0, 0.10);
+    std::uniform_real_distribution<double> place(-80.0, 80.0);
+
+    vector<Vector3d> anchors;
+    for (int a = 0; a < num_anchors; ++a) anchors.push_back(Vector3d(place(rng), place(rng), 50.0 + place(rng) * 0.5));
+
+    Scenario s;
+    s.start = Vector3d(100.0, 0.0, 50.0);
+    for (int k = 0; k < num_steps; ++k) {
+        double t = (k + 1) * dt;
+        Vector3d target = s.start + Vector3d(2.5 * t, 10.0 * sin(0.2 * t), 5.0 * cos(0.2 * t));
+        vector<TDoAEKF::Msmnt> meas;
+        for (const auto& a : anchors) {
+            TDoAEKF::Msmnt m;
+            m.anchor_pos = a;
+            m.tx_timestamp = t;
+            m.toa = t + ((target - a).norm() + noise(rng)) / C_LIGHT + 1e-8;
+            meas.push_back(m);
+        }
+        s.steps.push_back(meas);
+    }
+    return s;
+}
+
+template <class Filter>
+static double RunFilter(const Scenario& s, double dt, int repeats, Vector3d& final_pos) {
+    auto t0 = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        Filter ekf;
+        ekf.Init(s.start);
+        for (const auto& meas : s.steps) {
+            ekf.Predict(dt);
+            ekf.Update(meas);
+        }
+        final_pos = ekf.GetPosition();
+    }
+    auto t1 = chrono::steady_clock::now();
+    double total_ns = chrono::duration<double, nano>(t1 - t0).count();
+    return total_ns / (double)(repeats * s.steps.size());
+}
+
+int main(int argc, char* argv[]) {
+    int repeats = (argc > 1) ? atoi(argv[1]) : 200;
+    const int num_steps = 500;
+    const double dt = 0.03;
+    const int anchor_counts[] = {4, 5, 8, 12, 16};
+
+    printf("%-8s %16s %16s %10s %14s\n", "anchors", "TDoAEKF [ns]", "Fixed [ns]", "speedup", "max |dpos| [m]");
+    for (int n : anchor_counts) {
+        Scenario s = BuildScenario(n, num_steps, dt, 1234u + n);
+
+        Vector3d pos_dyn = Vector3d::Zero(), pos_fix = Vector3d::Zero();
+        double ns_dyn = RunFilter<TDoAEKF>(s, dt, repeats, pos_dyn);
+        double ns_fix = RunFilter<FixedTDoAEKF<16>>(s, dt, repeats, pos_fix);
+
+        printf("%-8d %16.1f %16.1f %9.2fx %14.3e\n", n, ns_dyn, ns_fix, ns_dyn / ns_fix, (pos_dyn - pos_fix).norm());
+    }
+    return 0;
+}
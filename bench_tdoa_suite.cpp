@@ -0,0 +1,732 @@
+/**
+ * Microbenchmark dei percorsi caldi della localizzazione, con risultati in JSON per
+ * confrontare versioni diverse (stessa macchina, stesse opzioni):
+ *
+ *   ekf_predict / ekf_update     TDoAEKF::Predict e TDoAEKF::Update al variare delle ancore
+ *   ekf_update_sequential        TDoAEKF::Update in modo UPDATE_SEQUENTIAL (stesse misure)
+ *   multilateration_fix          SolveMultilateration (fix in forma chiusa di uno slot) al variare delle ancore
+ *   channel_link                 UWBChannel::ComputeChannelCondition (un link) per ambiente
+ *   channel_block                UWBChannel::ComputeChannelConditions, costo per link su 64 link
+ *   drone_compute_neighbor       Drone::ComputeNeighborPosition al variare delle misure
+ *   drone_recovered_position     Drone::GetRecoveredPosition al variare delle stime dei pari
+ *   execute_slot                 uno slot TDMA completo (TDMAScheduler::ExecuteSlot) da 6 a 512 droni
+ *
+ * e il report di scalabilita' end-to-end: slot simulati al secondo (costruzione inclusa)
+ * in funzione della dimensione dello sciame.
+ *
+ * Riuso spaziale: con portata UWB limitata (pattuglia circolare, uwb_range = 30 m) la stessa
+ * run in round robin e con tdma_mode = spatial_reuse; per ogni dimensione dello sciame
+ * "spatial_reuse" nel JSON riporta slot per giro, frequenza di aggiornamento per drone e
+ * misure processate per secondo simulato. "spatial_reuse_accuracy" confronta l'RMSE delle due
+ * modalita' (32 droni, uwb_range = 60 m) con entrambi i clock_sync: con clock_sync = filter il
+ * riuso non deve peggiorarlo, altrimenti il controllo fallisce.
+ *
+ * Controllo delle allocazioni: operator new e' contato in tutto il processo e, dopo il
+ * riscaldamento (filtri inizializzati, attacco in corso con allarmi e recupero), gli slot
+ * TDMA devono girare senza allocazioni sull'heap. Le configurazioni controllate (sciame pieno,
+ * portata limitata, pool di thread, telemetria, metriche in streaming) finiscono in "allocations" nel JSON; se una
+ * alloca il programma termina con codice 2, quindi una regressione fa fallire chi lo lancia.
+ *
+ * Controlli di correttezza (niente tempi): comportamenti che una regressione romperebbe senza
+ * cambiare i tempi, es. una traiettoria personalizzata su un drone della formazione che deve
+ * sopravvivere a SetTime, o il riuso spaziale che peggiora l'RMSE. Un controllo fallito stampa FAIL e il programma termina con codice 3.
+ *
+ * Ogni misura raddoppia il numero di iterazioni finche' non dura almeno --minTime secondi.
+ * execute_slot gira su una SwarmSimulation con EventLoop interno: dopo un giro TDMA completo
+ * di riscaldamento (tutti i filtri inizializzati, attacco attivo) la run avanza a tratti di
+ * slot con RunUntil e si misura il tempo per slot.
+ *
+ * Uso: ./bench_tdoa_suite [--out=bench_results.json] [--label=v1] [--minTime=0.25] [--maxDrones=512]
+ *                         [--threads=0] [--quick=false]
+ */
+
+#include "TDoAEKF.h"
+#include "UWBChannel.h"
+#include "Drone.h"
+#include "SwarmFilterBank.h"
+#include "Multilateration.h"
+#include "SwarmSimulation.h"
+#include "WorkerPool.h"
+#include "Scenario.h"
+#include "KinematicsEngine.h"
+#include "TelemetryWriter.h"
+#include "MetricsAggregator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Eigen;
+using namespace std;
+
+static const double C_LIGHT = 299792458.0;
+static volatile double g_sink = 0.0;
+
+// Allocazioni sull'heap di tutto il processo (thread del pool compresi)
+static std::atomic<uint64_t> g_heap_allocs{0};
+
+// noinline: GCC non deve vedere malloc/free dentro i chiamanti (falso -Wmismatched-new-delete)
+__attribute__((noinline)) void* operator new(size_t size) {
+    g_heap_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+__attribute__((noinline)) void* operator new[](size_t size) { return operator new(size); }
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+struct BenchResult {
+    string name;
+    vector<pair<string, string>> params;
+    uint64_t iterations;
+    double ns_per_op;
+};
+
+struct AllocationCheck {
+    string config;
+    uint64_t slots;
+    uint64_t allocations;
+};
+
+struct ScalingPoint {
+    int drones;
+    uint64_t slots;
+    double wall_s;
+    double slots_per_s;
+};
+
+struct ReusePoint {
+    int drones;
+    string mode;
+    int slots_per_frame;
+    double update_hz;         // trasmissioni al secondo di ogni drone
+    double observations_per_s;   // update (osservatore, target) per secondo simulato
+    double wall_s;
+};
+
+// Stessa run in round robin e con riuso spaziale: RMSE medio su alcuni semi
+struct ReuseAccuracy {
+    string formation;
+    string clock_sync;
+    double rmse_round_robin;
+    double rmse_spatial_reuse;
+};
+
+struct Options {
+    string out_file = "bench_results.json";
+    string label = "";
+    double min_time = 0.25;
+    int max_drones = 512;
+    uint32_t threads = 0;
+    bool quick = false;
+};
+
+static double Seconds(chrono::steady_clock::time_point a, chrono::steady_clock::time_point b) {
+    return chrono::duration<double>(b - a).count();
+}
+
+// Esegue batch(n) con n raddoppiato finche' non dura almeno min_time; ns per operazione
+template <class F>
+static BenchResult Measure(const string& name, double min_time, F&& batch) {
+    uint64_t n = 1;
+    for (;;) {
+        auto t0 = chrono::steady_clock::now();
+        batch(n);
+        double el = Seconds(t0, chrono::steady_clock::now());
+        if (el >= min_time || n >= (1ull << 40)) return {name, {}, n, el * 1e9 / (double)n};
+        n *= 2;
+    }
+}
+
+static vector<Vector3d> RandomAnchors(int n, std::mt19937& rng) {
+    std::uniform_real_distribution<double> place(-80.0, 80.0);
+    vector<Vector3d> anchors;
+    for (int a = 0; a < n; ++a) anchors.push_back(Vector3d(place(rng), place(rng), 50.0 + place(rng) * 0.5));
+    return anchors;
+}
+
+// Target su una traiettoria periodica di 'steps' passi: il ciclo delle misure si richiude senza salti
+static Vector3d TargetAt(int k, int steps) {
+    double w = 2.0 * M_PI * k / steps;
+    return Vector3d(100.0 + 30.0 * cos(w), 30.0 * sin(w), 50.0 + 5.0 * sin(2.0 * w));
+}
+
+static void BenchEkf(const Options& opt, vector<BenchResult>& out) {
+    const int steps = 500;
+    const double dt = 0.03;
+    for (int n_anchors : {4, 5, 8, 12, 16}) {
+        std::mt19937 rng(1234u + n_anchors);
+        std::normal_distribution<double> noise(0.0, 0.10);
+        vector<Vector3d> anchors = RandomAnchors(n_anchors, rng);
+
+        vector<vector<TDoAEKF::Msmnt>> meas(steps);
+        for (int k = 0; k < steps; ++k) {
+            double t = (k + 1) * dt;
+            for (const auto& a : anchors) {
+                TDoAEKF::Msmnt m;
+                m.anchor_pos = a;
+                m.tx_timestamp = t;
+                m.toa = t + ((TargetAt(k, steps) - a).norm() + noise(rng)) / C_LIGHT + 1e-8;
+                meas[k].push_back(m);
+            }
+        }
+
+        TDoAEKF ekf;
+        BenchResult predict = Measure("ekf_predict", opt.min_time, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                if (i % steps == 0) ekf.Init(TargetAt(0, steps));
+                ekf.Predict(dt);
+            }
+            g_sink = g_sink + ekf.GetPosition().x();
+        });
+        BenchResult cycle = Measure("ekf_cycle", opt.min_time, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                int k = (int)(i % steps);
+                if (k == 0) ekf.Init(TargetAt(0, steps));
+                ekf.Predict(dt);
+                ekf.Update(meas[k]);
+            }
+            g_sink = g_sink + ekf.GetPosition().x();
+        });
+
+        // Update da solo non si puo' ripetere sullo stesso stato: costo del ciclo meno il Predict
+        BenchResult update = cycle;
+        update.name = "ekf_update";
+        update.ns_per_op = std::max(0.0, cycle.ns_per_op - predict.ns_per_op);
+
+        // Stesso ciclo con l'update sequenziale (innovazioni scalari, nessuna inversione)
+        TDoAEKF seq;
+        seq.SetUpdateMode(TDoAEKF::UPDATE_SEQUENTIAL);
+        BenchResult seq_cycle = Measure("ekf_cycle", opt.min_time, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                int k = (int)(i % steps);
+                if (k == 0) seq.Init(TargetAt(0, steps));
+                seq.Predict(dt);
+                seq.Update(meas[k]);
+            }
+            g_sink = g_sink + seq.GetPosition().x();
+        });
+        BenchResult seq_update = seq_cycle;
+        seq_update.name = "ekf_update_sequential";
+        seq_update.ns_per_op = std::max(0.0, seq_cycle.ns_per_op - predict.ns_per_op);
+
+        predict.params = {{"anchors", to_string(n_anchors)}};
+        update.params = {{"anchors", to_string(n_anchors)}};
+        seq_update.params = {{"anchors", to_string(n_anchors)}};
+        out.push_back(predict);
+        out.push_back(update);
+        out.push_back(seq_update);
+    }
+}
+
+static void BenchMultilateration(const Options& opt, vector<BenchResult>& out) {
+    const int steps = 256;
+    for (int n_anchors : {4, 5, 8, 12, 16}) {
+        std::mt19937 rng(4321u + n_anchors);
+        std::normal_distribution<double> noise(0.0, 0.10);
+        vector<Vector3d> anchors = RandomAnchors(n_anchors, rng);
+
+        vector<vector<RangingMeasurement>> meas(steps);
+        for (int k = 0; k < steps; ++k) {
+            for (int a = 0; a < n_anchors; ++a) {
+                double toa = ((TargetAt(k, steps) - anchors[a]).norm() + noise(rng)) / C_LIGHT + 1e-8;
+                meas[k].push_back({1u, (uint32_t)(a + 2), anchors[a], toa, true});
+            }
+        }
+
+        BenchResult r = Measure("multilateration_fix", opt.min_time, [&](uint64_t n) {
+            double acc = 0.0;
+            MultilaterationFix fix;
+            for (uint64_t i = 0; i < n; ++i) {
+                const vector<RangingMeasurement>& m = meas[i % steps];
+                if (SolveMultilateration(m.data(), (int)m.size(), 0.0, fix)) acc += fix.position.x();
+            }
+            g_sink = g_sink + acc;
+        });
+        r.params = {{"anchors", to_string(n_anchors)}};
+        out.push_back(r);
+    }
+}
+
+static void BenchChannel(const Options& opt, vector<BenchResult>& out) {
+    const int n_links = 256;
+    std::mt19937 rng(99);
+    std::uniform_real_distribution<double> place(-120.0, 120.0);
+    const Vector3d tx(100.0, 0.0, 50.0);
+    vector<Vector3d> rx;
+    for (int i = 0; i < n_links; ++i) rx.push_back(tx + Vector3d(place(rng), place(rng), 0.2 * place(rng)));
+
+    for (const char* env : {"outdoor", "indoor", "mixed"}) {
+        UWBChannel channel;
+        channel.SetEnvironment(env);
+        channel.SetSeed(7);
+        BenchResult r = Measure("channel_link", opt.min_time, [&](uint64_t n) {
+            double acc = 0.0;
+            for (uint64_t i = 0; i < n; ++i) acc += channel.ComputeChannelCondition(tx, rx[i % n_links], 0.0).rssi_dbm;
+            g_sink = g_sink + acc;
+        });
+        r.params = {{"environment", env}};
+        out.push_back(r);
+    }
+
+    const int block = 64;
+    UWBChannel channel;
+    channel.SetEnvironment("outdoor");
+    channel.SetSeed(7);
+    channel.SetNumReceivers(block);
+    vector<int> ids(block);
+    for (int i = 0; i < block; ++i) ids[i] = i;
+    ChannelConditionBlock cond;
+    cond.Resize(block);
+    BenchResult r = Measure("channel_block", opt.min_time, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) channel.ComputeChannelConditions(tx, rx.data(), ids.data(), 0, block, 0.0, cond);
+        g_sink = g_sink + cond.rssi_dbm[0];
+    });
+    r.iterations *= block;
+    r.ns_per_op /= block;
+    r.params = {{"environment", "outdoor"}, {"links", to_string(block)}};
+    out.push_back(r);
+}
+
+static void BenchDrone(const Options& opt, vector<BenchResult>& out) {
+    const int steps = 500;
+    const double slot = 0.005;
+
+    // Osservatore 0, trasmettitore 1, ancore 2..m+1
+    for (int m : {4, 8, 16}) {
+        std::mt19937 rng(4321u + m);
+        std::normal_distribution<double> noise(0.0, 0.10);
+        vector<Vector3d> anchors = RandomAnchors(m, rng);
+        SwarmFilterBank bank(m + 2);
+        Drone observer;
+        observer.SetId(0);
+        observer.SetFilterBank(&bank);
+
+        // Per ogni passo: posizione GPS dichiarata e ritardi di propagazione delle m misure
+        vector<Vector3d> gps(steps);
+        vector<vector<double>> delay(steps, vector<double>(m));
+        for (int k = 0; k < steps; ++k) {
+            gps[k] = TargetAt(k, steps) + Vector3d(noise(rng), noise(rng), noise(rng));
+            for (int a = 0; a < m; ++a) delay[k][a] = ((TargetAt(k, steps) - anchors[a]).norm() + noise(rng)) / C_LIGHT;
+        }
+        vector<RangingMeasurement> meas(m);
+        for (int a = 0; a < m; ++a) meas[a] = {1u, (uint32_t)(a + 2), anchors[a], 0.0, true};
+
+        double t = 0.0;
+        BenchResult r = Measure("drone_compute_neighbor", opt.min_time, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                int k = (int)(i % steps);
+                t += slot;
+                for (int a = 0; a < m; ++a) meas[a].toa_seconds = t + delay[k][a];
+                observer.ComputeNeighborPosition(1, gps[k], meas, t, t);
+            }
+            g_sink = g_sink + observer.GetEstimatedPositionOf(1).x();
+        });
+        r.params = {{"measurements", to_string(m)}};
+        out.push_back(r);
+    }
+
+    for (int peers : {5, 16, 64, 256}) {
+        std::mt19937 rng(77u + peers);
+        std::normal_distribution<double> noise(0.0, 2.0);
+        map<int, Vector3d> estimates;
+        for (int p = 1; p <= peers; ++p) estimates[p] = Vector3d(100.0 + noise(rng), noise(rng), 50.0 + noise(rng));
+        Drone drone;
+        drone.SetId(0);
+        BenchResult r = Measure("drone_recovered_position", opt.min_time, [&](uint64_t n) {
+            double acc = 0.0;
+            for (uint64_t i = 0; i < n; ++i) acc += drone.GetRecoveredPosition(0, estimates).x();
+            g_sink = g_sink + acc;
+        });
+        r.params = {{"peers", to_string(peers)}};
+        out.push_back(r);
+    }
+}
+
+static vector<int> SwarmSizes(const Options& opt) {
+    vector<int> sizes;
+    for (int n : {6, 16, 32, 64, 128, 256, 512})
+        if (n <= opt.max_drones) sizes.push_back(n);
+    return sizes;
+}
+
+static Scenario BenchScenario(int drones, double sim_time, double attack_time) {
+    Scenario s;
+    s.num_drones = drones;
+    s.sim_time = sim_time;
+    s.time_of_malicious = attack_time;
+    s.seed = 1;
+    return s;
+}
+
+static void BenchExecuteSlot(const Options& opt, WorkerPool* pool, vector<BenchResult>& out) {
+    for (int n : SwarmSizes(opt)) {
+        // Un giro TDMA completo di riscaldamento; l'attacco parte alla fine del giro
+        const double slot = Scenario().slot_duration;
+        const double warm = (n + 0.5) * slot;
+        Scenario s = BenchScenario(n, 1e9, warm);
+        SwarmSimulation sim(s);
+        sim.SetVerbose(false);
+        sim.SetWorkerPool(pool);
+        sim.Start();
+        double t = warm;
+        sim.RunUntil(t);
+
+        BenchResult r = Measure("execute_slot", opt.min_time, [&](uint64_t k) {
+            t += k * slot;
+            sim.RunUntil(t);
+        });
+        g_sink = g_sink + sim.GetStats().Rmse();
+        r.params = {{"drones", to_string(n)}, {"threads", to_string(pool ? pool->GetNumThreads() : 1)}};
+        out.push_back(r);
+        printf("  execute_slot drones=%-4d %12.1f ns/slot\n", n, r.ns_per_op);
+        fflush(stdout);
+    }
+}
+
+// Slot a regime senza allocazioni: riscaldamento fino a 8 s (attacco a 0.5 s, quindi allarmi,
+// recupero e ResetState sono gia' passati), poi almeno due giri TDMA contati
+static void CheckSlotAllocations(WorkerPool* pool, vector<AllocationCheck>& out) {
+    struct Config { const char* name; int drones; double range; bool telemetry; const char* mode; const char* sync; bool metrics; bool compressed; };
+    const Config configs[] = {
+        {"drones=6", 6, 0.0, false, "round_robin", "master", false, false},
+        {"drones=64", 64, 0.0, false, "round_robin", "master", false, false},
+        {"drones=64 uwb_range=60", 64, 60.0, false, "round_robin", "master", false, false},
+        {"drones=128 uwb_range=30 spatial_reuse", 128, 30.0, false, "spatial_reuse", "master", false, false},
+        {"drones=64 adaptive", 64, 0.0, false, "adaptive", "master", false, false},
+        {"drones=64 clock_sync=filter", 64, 0.0, false, "round_robin", "filter", false, false},
+        {"drones=64 metrics", 64, 0.0, false, "round_robin", "master", true, false},
+        {"drones=6 telemetry", 6, 0.0, true, "round_robin", "master", false, false},
+        {"drones=6 telemetry compressed", 6, 0.0, true, "round_robin", "master", false, true},
+    };
+    for (const Config& c : configs) {
+        Scenario s = BenchScenario(c.drones, 1e9, 0.5);
+        s.uwb_range = c.range;
+        s.tdma_mode = c.mode;
+        s.clock_sync = c.sync;
+        // Con il riuso conta anche la ricolorazione a ogni giro: deve riusare i propri buffer
+        if (s.tdma_mode == "spatial_reuse") s.formation = "circular_patrol";
+        // Il sink deve sopravvivere alla simulazione che ci scrive
+        unique_ptr<ColumnarTelemetryWriter> sink;
+        // Compressa: blocchi piccoli, cosi' la codifica e il deflate cadono dentro gli slot misurati
+        if (c.telemetry && c.compressed)
+            sink = make_unique<ColumnarTelemetryWriter>("bench_alloc_check.tlm", 256, ColumnarTelemetryWriter::CODEC_ZLIB);
+        else if (c.telemetry)
+            sink = make_unique<ColumnarTelemetryWriter>("bench_alloc_check.tlm");
+        // Finestre preallocate fino a 10 s: la misura finisce prima
+        unique_ptr<MetricsAggregator> metrics;
+        if (c.metrics) metrics = make_unique<MetricsAggregator>(c.drones, 10.0, 1.0);
+        unique_ptr<SwarmSimulation> sim_ptr = make_unique<SwarmSimulation>(s);
+        SwarmSimulation& sim = *sim_ptr;
+        sim.SetVerbose(false);
+        sim.SetWorkerPool(pool);
+        if (sink) sim.SetTelemetrySink(sink.get());
+        if (metrics) sim.SetMetrics(metrics.get());
+        sim.Start();
+        double t = 8.0;
+        sim.RunUntil(t);
+
+        const uint64_t slots = std::max<uint64_t>(200, 2 * (uint64_t)c.drones);
+        uint64_t before = g_heap_allocs.load();
+        sim.RunUntil(t + (slots + 0.5) * s.slot_duration);
+        uint64_t allocations = g_heap_allocs.load() - before;
+
+        string config = string(c.name) + (pool ? " threads=" + to_string(pool->GetNumThreads()) : "");
+        out.push_back({config, slots, allocations});
+        printf("  slot allocations %-40s %6llu in %llu slots%s\n", config.c_str(), (unsigned long long)allocations,
+               (unsigned long long)slots, allocations ? "   <-- REGRESSION" : "");
+        fflush(stdout);
+        if (sink) {
+            sim_ptr.reset();
+            sink.reset();
+            std::remove("bench_alloc_check.tlm");
+        }
+    }
+}
+
+static void BenchScaling(const Options& opt, WorkerPool* pool, vector<ScalingPoint>& out) {
+    for (int n : SwarmSizes(opt)) {
+        // Almeno due giri TDMA (uno con --quick), e abbastanza slot da non misurare solo la costruzione
+        const double slot = Scenario().slot_duration;
+        const uint64_t slots = opt.quick ? std::max<uint64_t>(200, n) : std::max<uint64_t>(1000, 2 * (uint64_t)n);
+        const double sim_time = (slots + 0.5) * slot;
+        Scenario s = BenchScenario(n, sim_time, sim_time / 2);
+
+        auto t0 = chrono::steady_clock::now();
+        SwarmSimulation sim(s);
+        sim.SetVerbose(false);
+        sim.SetWorkerPool(pool);
+        RunStats stats = sim.Run();
+        double wall = Seconds(t0, chrono::steady_clock::now());
+        g_sink = g_sink + stats.Rmse();
+
+        out.push_back({n, slots, wall, slots / wall});
+        printf("  scaling      drones=%-4d %8llu slots %9.3f s %12.1f slots/s\n", n, (unsigned long long)slots, wall, slots / wall);
+        fflush(stdout);
+    }
+}
+
+static void BenchSpatialReuse(const Options& opt, WorkerPool* pool, vector<ReusePoint>& out) {
+    const double sim_time = opt.quick ? 1.0 : 4.0;
+    for (int n : SwarmSizes(opt)) {
+        if (n < 32) continue;
+        for (const char* mode : {"round_robin", "spatial_reuse"}) {
+            Scenario s = BenchScenario(n, sim_time, sim_time / 2);
+            s.formation = "circular_patrol";
+            s.uwb_range = 30.0;
+            s.tdma_mode = mode;
+
+            auto t0 = chrono::steady_clock::now();
+            SwarmSimulation sim(s);
+            sim.SetVerbose(false);
+            sim.SetWorkerPool(pool);
+            RunStats stats = sim.Run();
+            double wall = Seconds(t0, chrono::steady_clock::now());
+
+            ReusePoint p;
+            p.drones = n;
+            p.mode = mode;
+            p.slots_per_frame = sim.GetSlotsPerFrame();
+            p.update_hz = 1.0 / (p.slots_per_frame * s.slot_duration);
+            p.observations_per_s = stats.observations / sim_time;
+            p.wall_s = wall;
+            out.push_back(p);
+            printf("  reuse        drones=%-4d %-14s %4d slots/frame %8.1f Hz/drone %12.0f obs/s %8.3f s\n", n, mode,
+                   p.slots_per_frame, p.update_hz, p.observations_per_s, wall);
+            fflush(stdout);
+        }
+    }
+}
+
+// Il riuso non deve peggiorare la stima con clock_sync = filter (oltre REUSE_RMSE_TOLERANCE);
+// con clock_sync = master il costo e' noto (droni fuori portata del Master, vedi TDMAScheduler.h)
+// e viene solo riportato nel JSON
+static const double REUSE_RMSE_TOLERANCE = 1.10;
+
+static void CheckSpatialReuseAccuracy(const Options& opt, WorkerPool* pool, vector<ReuseAccuracy>& out,
+                                      vector<string>& failures) {
+    const double sim_time = opt.quick ? 20.0 : 60.0;
+    const int seeds = opt.quick ? 1 : 3;
+    for (const char* sync : {"filter", "master"}) {
+        for (const char* formation : {"circular_patrol", "atomic_shell"}) {
+            ReuseAccuracy a;
+            a.formation = formation;
+            a.clock_sync = sync;
+            for (const char* mode : {"round_robin", "spatial_reuse"}) {
+                double rmse = 0.0;
+                for (int seed = 1; seed <= seeds; ++seed) {
+                    Scenario s = BenchScenario(32, sim_time, sim_time / 2);
+                    s.seed = seed;
+                    s.formation = formation;
+                    s.uwb_range = 60.0;
+                    s.clock_sync = sync;
+                    s.tdma_mode = mode;
+                    SwarmSimulation sim(s);
+                    sim.SetVerbose(false);
+                    sim.SetWorkerPool(pool);
+                    rmse += sim.Run().Rmse() / seeds;
+                }
+                (string(mode) == "round_robin" ? a.rmse_round_robin : a.rmse_spatial_reuse) = rmse;
+            }
+            out.push_back(a);
+            printf("  reuse rmse   clock_sync=%-6s %-16s round_robin %10.2f m  spatial_reuse %10.2f m\n", sync, formation,
+                   a.rmse_round_robin, a.rmse_spatial_reuse);
+            fflush(stdout);
+            if (a.clock_sync == "filter" && a.rmse_spatial_reuse > REUSE_RMSE_TOLERANCE * a.rmse_round_robin) {
+                failures.push_back("spatial_reuse worsens RMSE with clock_sync=filter, " + a.formation + ": " +
+                                   to_string(a.rmse_spatial_reuse) + " m vs " + to_string(a.rmse_round_robin) + " m");
+            }
+        }
+    }
+}
+
+static string JsonEscape(const string& s) {
+    string r;
+    for (char c : s) {
+        if (c == '"' || c == '\\') r += '\\';
+        r += c;
+    }
+    return r;
+}
+
+static bool WriteJson(const Options& opt, WorkerPool* pool, const vector<BenchResult>& results,
+                      const vector<AllocationCheck>& allocations, const vector<ScalingPoint>& scaling,
+                      const vector<ReusePoint>& reuse, const vector<ReuseAccuracy>& accuracy) {
+    FILE* f = fopen(opt.out_file.c_str(), "w");
+    if (!f) return false;
+
+    char stamp[32];
+    time_t now = time(nullptr);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+#ifdef NDEBUG
+    const bool ndebug = true;
+#else
+    const bool ndebug = false;
+#endif
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"suite\": \"tdoa\",\n");
+    fprintf(f, "  \"label\": \"%s\",\n", JsonEscape(opt.label).c_str());
+    fprintf(f, "  \"timestamp\": \"%s\",\n", stamp);
+    fprintf(f, "  \"compiler\": \"%s\",\n", JsonEscape(__VERSION__).c_str());
+    fprintf(f, "  \"ndebug\": %s,\n", ndebug ? "true" : "false");
+    fprintf(f, "  \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+    fprintf(f, "  \"threads\": %u,\n", pool ? pool->GetNumThreads() : 1u);
+    fprintf(f, "  \"min_time_s\": %g,\n", opt.min_time);
+
+    // Un risultato per riga: diff e grep tra due file restano leggibili
+    fprintf(f, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        fprintf(f, "    {\"name\": \"%s\", \"params\": {", r.name.c_str());
+        for (size_t p = 0; p < r.params.size(); ++p) {
+            fprintf(f, "%s\"%s\": \"%s\"", p ? ", " : "", r.params[p].first.c_str(), JsonEscape(r.params[p].second).c_str());
+        }
+        fprintf(f, "}, \"iterations\": %llu, \"ns_per_op\": %.3f, \"ops_per_s\": %.1f}%s\n",
+                (unsigned long long)r.iterations, r.ns_per_op, r.ns_per_op > 0 ? 1e9 / r.ns_per_op : 0.0,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ],\n");
+
+    fprintf(f, "  \"allocations\": [\n");
+    for (size_t i = 0; i < allocations.size(); ++i) {
+        const AllocationCheck& a = allocations[i];
+        fprintf(f, "    {\"config\": \"%s\", \"slots\": %llu, \"allocations\": %llu}%s\n", JsonEscape(a.config).c_str(),
+                (unsigned long long)a.slots, (unsigned long long)a.allocations, i + 1 < allocations.size() ? "," : "");
+    }
+    fprintf(f, "  ],\n");
+
+    fprintf(f, "  \"scaling\": [\n");
+    for (size_t i = 0; i < scaling.size(); ++i) {
+        const ScalingPoint& s = scaling[i];
+        fprintf(f, "    {\"drones\": %d, \"slots\": %llu, \"wall_s\": %.6f, \"slots_per_s\": %.1f}%s\n",
+                s.drones, (unsigned long long)s.slots, s.wall_s, s.slots_per_s, i + 1 < scaling.size() ? "," : "");
+    }
+    fprintf(f, "  ],\n");
+
+    fprintf(f, "  \"spatial_reuse\": [\n");
+    for (size_t i = 0; i < reuse.size(); ++i) {
+        const ReusePoint& r = reuse[i];
+        fprintf(f, "    {\"drones\": %d, \"mode\": \"%s\", \"slots_per_frame\": %d, \"update_hz\": %.2f, "
+                   "\"observations_per_s\": %.1f, \"wall_s\": %.6f}%s\n",
+                r.drones, r.mode.c_str(), r.slots_per_frame, r.update_hz, r.observations_per_s, r.wall_s,
+                i + 1 < reuse.size() ? "," : "");
+    }
+    fprintf(f, "  ],\n");
+
+    fprintf(f, "  \"spatial_reuse_accuracy\": [\n");
+    for (size_t i = 0; i < accuracy.size(); ++i) {
+        const ReuseAccuracy& a = accuracy[i];
+        fprintf(f, "    {\"drones\": 32, \"uwb_range\": 60, \"formation\": \"%s\", \"clock_sync\": \"%s\", "
+                   "\"rmse_round_robin\": %.4f, \"rmse_spatial_reuse\": %.4f}%s\n",
+                a.formation.c_str(), a.clock_sync.c_str(), a.rmse_round_robin, a.rmse_spatial_reuse,
+                i + 1 < accuracy.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return true;
+}
+
+static bool ParseArgs(int argc, char* argv[], Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == string::npos) return false;
+        string key = arg.substr(2, eq - 2);
+        string value = arg.substr(eq + 1);
+        if (key == "out") opt.out_file = value;
+        else if (key == "label") opt.label = value;
+        else if (key == "minTime") opt.min_time = std::atof(value.c_str());
+        else if (key == "maxDrones") opt.max_drones = std::atoi(value.c_str());
+        else if (key == "threads") opt.threads = (uint32_t)std::strtoul(value.c_str(), nullptr, 10);
+        else if (key == "quick") opt.quick = (value == "true" || value == "1");
+        else return false;
+    }
+    return true;
+}
+
+// Controlli di correttezza: ogni fallimento aggiunge un messaggio a failures
+static void CheckKinematicsOverride(vector<string>& failures) {
+    KinematicsEngine engine(6);
+    engine.SetFormation(BuildSwarmFormation(FORMATION_OCTAHEDRON, 6));
+    engine.SetTrajectory(2, [](double t) { return Vector3d(t, 100.0, 50.0); });
+    KinematicsEngine reference(6);
+    reference.SetFormation(BuildSwarmFormation(FORMATION_OCTAHEDRON, 6));
+    for (double t : {1.5, 2.0, 7.25}) {
+        engine.SetTime(t);
+        reference.SetTime(t);
+        if ((engine.GetPosition(2) - Vector3d(t, 100.0, 50.0)).norm() > 1e-12)
+            failures.push_back("KinematicsEngine: SetTrajectory on a formation drone overwritten at t=" + to_string(t));
+        if ((engine.GetPosition(3) - reference.GetPosition(3)).norm() > 1e-12)
+            failures.push_back("KinematicsEngine: formation drone 3 moved by another drone's SetTrajectory");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    if (!ParseArgs(argc, argv, opt)) {
+        fprintf(stderr, "Uso: %s [--out=bench_results.json] [--label=...] [--minTime=0.25] [--maxDrones=512] "
+                        "[--threads=0] [--quick=false]\n", argv[0]);
+        return 1;
+    }
+    if (opt.quick) opt.min_time = std::min(opt.min_time, 0.02);
+
+    unique_ptr<WorkerPool> pool;
+    if (opt.threads > 1) pool = make_unique<WorkerPool>(opt.threads);
+
+    vector<BenchResult> results;
+    vector<AllocationCheck> allocations;
+    vector<ScalingPoint> scaling;
+    vector<ReusePoint> reuse;
+    vector<ReuseAccuracy> reuse_accuracy;
+
+    vector<string> failures;
+    CheckKinematicsOverride(failures);
+
+    BenchEkf(opt, results);
+    BenchMultilateration(opt, results);
+    BenchChannel(opt, results);
+    BenchDrone(opt, results);
+
+    printf("%-26s %-34s %14s %14s\n", "benchmark", "params", "ns/op", "ops/s");
+    for (const auto& r : results) {
+        string params;
+        for (const auto& p : r.params) params += (params.empty() ? "" : " ") + p.first + "=" + p.second;
+        printf("%-26s %-34s %14.1f %14.0f\n", r.name.c_str(), params.c_str(), r.ns_per_op, 1e9 / std::max(r.ns_per_op, 1e-9));
+    }
+    fflush(stdout);
+
+    BenchExecuteSlot(opt, pool.get(), results);
+    CheckSlotAllocations(pool.get(), allocations);
+    BenchScaling(opt, pool.get(), scaling);
+    BenchSpatialReuse(opt, pool.get(), reuse);
+    CheckSpatialReuseAccuracy(opt, pool.get(), reuse_accuracy, failures);
+
+    if (!WriteJson(opt, pool.get(), results, allocations, scaling, reuse, reuse_accuracy)) {
+        fprintf(stderr, "cannot write %s\n", opt.out_file.c_str());
+        return 1;
+    }
+    printf("--- Results in %s ---\n", opt.out_file.c_str());
+
+    for (const auto& a : allocations) {
+        if (a.allocations == 0) continue;
+        fprintf(stderr, "FAIL: %s allocates on the heap in steady state (%llu allocations in %llu slots)\n",
+                a.config.c_str(), (unsigned long long)a.allocations, (unsigned long long)a.slots);
+        return 2;
+    }
+    for (const string& f : failures) fprintf(stderr, "FAIL: %s\n", f.c_str());
+    return failures.empty() ? 0 : 3;
+}
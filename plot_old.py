@@ -4,14 +4,15 @@ from mpl_toolkits.mplot3d import Axes3D
 import numpy as np
 import sys
 
+from tdoa_log import read_log
+
 def main():
-    filename = 'tdma_security_log.csv'
     print(f"--- Visualizzatore Sciame (Solo Visione Globale e Dettagli) ---")
     
     try:
-        df = pd.read_csv(filename)
-    except FileNotFoundError:
-        print(f"ERRORE: File '{filename}' non trovato.")
+        df = read_log()
+    except FileNotFoundError as e:
+        print(f"ERRORE: File '{e}' non trovato.")
         return
 
     available_ids = sorted(df['sender_id'].unique())
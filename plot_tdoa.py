@@ -4,6 +4,8 @@ from mpl_toolkits.mplot3d import Axes3D
 import numpy as np
 import sys
 
+from tdoa_log import read_log
+
 # Impostazioni grafiche generali
 plt.rcParams.update({'font.size': 10, 'figure.autolayout': True})
 
@@ -19,13 +21,12 @@ def calculate_metrics(df_target):
     return mean_err, rmse, max_err, alarm_rate
 
 def main():
-    filename = 'tdma_security_log.csv'
     print(f"--- Dashboard Unificata TDoA UWB ---")
     
     try:
-        df = pd.read_csv(filename)
-    except FileNotFoundError:
-        print(f"ERRORE: File '{filename}' non trovato. Esegui prima la simulazione ns-3.")
+        df = read_log()
+    except FileNotFoundError as e:
+        print(f"ERRORE: File '{e}' non trovato. Esegui prima la simulazione ns-3.")
         return
 
     # Selezione Target (Default 0)
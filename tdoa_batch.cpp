@@ -0,0 +1,203 @@
+/**
+ * Runner Monte Carlo: esegue la stessa configurazione per un intervallo di semi e
+ * aggrega gli indicatori (RMSE, latenza d'allarme, tasso di falsi allarmi, errore di recupero).
+ *
+ * Le repliche girano sull'EventLoop interno (nessuna dipendenza da ns-3, nessuno stato globale):
+ * --jobs thread prelevano i semi da un contatore atomico e ognuno esegue una SwarmSimulation
+ * completa alla volta. Ogni replica usa scenario.seed = seme, quindi qualsiasi riga del
+ * risultato si riproduce con ./tdoa_main --scenario=... --seed=<seme> (con qualsiasi --engine).
+ *
+ * Uso: ./tdoa_batch --scenario=attack.cfg --seedBegin=1 --seedEnd=1000 [--jobs=0] [--out=batch_runs.csv]
+ */
+
+#include "Scenario.h"
+#include "SwarmSimulation.h"
+#include "RunStats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct ReplicaResult {
+    uint64_t seed;
+    double rmse;
+    double alarm_latency;
+    double false_alarm_rate;
+    double recovery_error;
+};
+
+struct Aggregate {
+    uint64_t n = 0;
+    double mean = 0.0, m2 = 0.0;
+    double min = INFINITY, max = -INFINITY;
+
+    void Add(double x) {
+        if (std::isnan(x)) return;
+        ++n;
+        double delta = x - mean;
+        mean += delta / n;
+        m2 += delta * (x - mean);
+        min = std::min(min, x);
+        max = std::max(max, x);
+    }
+    double Std() const { return n > 1 ? std::sqrt(m2 / (n - 1)) : 0.0; }
+    double Ci95() const { return n > 1 ? 1.96 * Std() / std::sqrt((double)n) : 0.0; }
+};
+
+static ReplicaResult RunReplica(const Scenario& base, uint64_t seed, SlotProfiler& profile) {
+    Scenario scenario = base;
+    scenario.seed = seed;
+
+    SwarmSimulation sim(scenario);
+    sim.SetVerbose(false);
+    RunStats stats = sim.Run();
+    profile = sim.GetProfiler();
+
+    ReplicaResult r;
+    r.seed = seed;
+    r.rmse = stats.Rmse();
+    r.alarm_latency = stats.AlarmLatency();
+    r.false_alarm_rate = stats.FalseAlarmRate();
+    r.recovery_error = stats.RecoveryError();
+    return r;
+}
+
+// --chiave=valore; restituisce false per opzioni sconosciute
+static bool ParseArgs(int argc, char* argv[], string& scenario_file, uint64_t& seed_begin, uint64_t& seed_end,
+                      uint32_t& jobs, string& out_file) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || eq == string::npos) return false;
+        string key = arg.substr(2, eq - 2);
+        string value = arg.substr(eq + 1);
+        if (key == "scenario") scenario_file = value;
+        else if (key == "seedBegin") seed_begin = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "seedEnd") seed_end = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "jobs") jobs = (uint32_t)std::strtoul(value.c_str(), nullptr, 10);
+        else if (key == "out") out_file = value;
+        else return false;
+    }
+    return true;
+}
+
+static void PrintAggregate(const char* name, const Aggregate& a, const char* unit) {
+    printf("%-18s n=%-6llu mean=%-12.5g std=%-12.5g ci95=+-%-10.4g min=%-10.5g max=%-10.5g %s\n",
+           name, (unsigned long long)a.n, a.mean, a.Std(), a.Ci95(), a.min, a.max, unit);
+}
+
+int main(int argc, char* argv[]) {
+    string scenario_file = "";
+    uint64_t seed_begin = 1;
+    uint64_t seed_end = 100;
+    uint32_t jobs = 0;
+    string out_file = "batch_runs.csv";
+    if (!ParseArgs(argc, argv, scenario_file, seed_begin, seed_end, jobs, out_file)) {
+        cerr << "Uso: " << argv[0] << " [--scenario=file] [--seedBegin=1] [--seedEnd=100] [--jobs=0] [--out=batch_runs.csv]" << endl;
+        return 1;
+    }
+
+    Scenario scenario;
+    if (!scenario_file.empty()) {
+        string error;
+        if (!scenario.LoadFile(scenario_file, error)) {
+            cerr << error << endl;
+            return 1;
+        }
+    }
+    string scenario_error;
+    if (!scenario.Validate(scenario_error)) {
+        cerr << scenario_error << endl;
+        return 1;
+    }
+    if (seed_end < seed_begin) {
+        cerr << "seedEnd < seedBegin" << endl;
+        return 1;
+    }
+    if (jobs == 0) jobs = std::max(1u, std::thread::hardware_concurrency());
+
+    // Aperto prima delle repliche: una campagna lunga non deve scoprire alla fine che non puo' salvarle
+    ofstream out(out_file);
+    if (!out.is_open()) {
+        cerr << "cannot write " << out_file << endl;
+        return 1;
+    }
+
+    cout << ">>> Monte Carlo: " << (seed_end - seed_begin + 1) << " replicas of " << scenario.num_drones
+         << " drones x " << scenario.sim_time << " s, " << jobs << " jobs" << endl;
+
+    const uint64_t num_replicas = seed_end - seed_begin + 1;
+    if (jobs > num_replicas) jobs = (uint32_t)num_replicas;
+
+    vector<ReplicaResult> results;
+    results.reserve(num_replicas);
+    std::mutex results_mutex;
+    SlotProfiler profile;
+    std::atomic<uint64_t> next_seed(seed_begin);
+    std::atomic<uint64_t> failed(0);
+
+    vector<std::thread> workers;
+    for (uint32_t j = 0; j < jobs; ++j) {
+        workers.emplace_back([&]() {
+            for (;;) {
+                uint64_t seed = next_seed.fetch_add(1);
+                if (seed > seed_end) break;
+                try {
+                    SlotProfiler replica_profile;
+                    ReplicaResult r = RunReplica(scenario, seed, replica_profile);
+                    std::lock_guard<std::mutex> lock(results_mutex);
+                    results.push_back(r);
+                    profile.Merge(replica_profile);
+                } catch (const std::exception& e) {
+                    std::lock_guard<std::mutex> lock(results_mutex);
+                    cerr << "replica seed " << seed << " failed: " << e.what() << endl;
+                    ++failed;
+                }
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+
+    std::sort(results.begin(), results.end(), [](const ReplicaResult& a, const ReplicaResult& b) { return a.seed < b.seed; });
+
+    out << "seed,rmse,alarm_latency,false_alarm_rate,recovery_error\n";
+    Aggregate rmse, latency, far, recovery;
+    uint64_t detected = 0;
+    for (const auto& r : results) {
+        out << r.seed << "," << r.rmse << "," << r.alarm_latency << "," << r.false_alarm_rate << "," << r.recovery_error << "\n";
+        rmse.Add(r.rmse);
+        latency.Add(r.alarm_latency);
+        far.Add(r.false_alarm_rate);
+        recovery.Add(r.recovery_error);
+        if (!std::isnan(r.alarm_latency)) ++detected;
+    }
+    out.flush();
+    bool written = (bool)out;
+
+    cout << "--- Aggregated over " << results.size() << " replicas (" << failed.load() << " failed) ---" << endl;
+    PrintAggregate("rmse", rmse, "m");
+    PrintAggregate("alarm_latency", latency, "s");
+    PrintAggregate("false_alarm_rate", far, "");
+    PrintAggregate("recovery_error", recovery, "m");
+    printf("%-18s %llu/%zu\n", "detected", (unsigned long long)detected, results.size());
+    if (SlotProfiler::Enabled()) {
+        cout << "--- Slot profile over all replicas (TDOA_PROFILE) ---" << endl;
+        profile.Print(cout);
+    }
+    if (!written) {
+        cerr << "error writing " << out_file << endl;
+        return 1;
+    }
+    cout << "--- Per-replica results in " << out_file << " ---" << endl;
+    return failed.load() ? 2 : 0;
+}
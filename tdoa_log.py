@@ -0,0 +1,207 @@
+"""
+Lettura della telemetria della simulazione TDoA.
+
+Il simulatore scrive di default il formato binario colonnare `tdma_security_log.tlm`
+(vedi TelemetryWriter.h); con --logFormat=csv scrive il vecchio `tdma_security_log.csv`.
+`read_log` accetta entrambi e restituisce lo stesso DataFrame che dava `pd.read_csv`,
+quindi gli script di analisi non devono sapere quale formato e' stato usato.
+
+Il file binario viene mappato in memoria: `load_columns` restituisce per ogni colonna
+un array numpy che punta direttamente nel file (nessuna copia se c'e' un solo blocco).
+
+Con --logFormat=compressed il .tlm e' in versione 2: blocchi compressi con zlib e un
+indice per tempo di simulazione in coda al file. `load_columns(path, t_start, t_end,
+columns)` decomprime solo i blocchi che intersecano la finestra e solo le colonne
+richieste, es. `read_log(t_start=TIME_OF_MALICIOUS - 5, t_end=TIME_OF_MALICIOUS + 20)`.
+La finestra vale anche per la versione 1, ma li' il filtro e' riga per riga.
+"""
+
+import mmap
+import os
+import struct
+import zlib
+
+import numpy as np
+import pandas as pd
+
+DEFAULT_BINARY = 'tdma_security_log.tlm'
+DEFAULT_CSV = 'tdma_security_log.csv'
+
+FILE_MAGIC = b'TDOATLM\0'
+BLOCK_MAGIC = 0x314B4C42  # "BLK1"
+COMPRESSED_BLOCK_MAGIC = 0x324B4C42  # "BLK2"
+INDEX_MAGIC = 0x32584449  # "IDX2"
+NAME_LEN = 24
+
+ENC_RAW = 0
+ENC_XOR_SHUFFLE = 1
+ENC_DELTA_SHUFFLE = 2
+
+_DTYPES = {
+    1: np.dtype('<f8'),
+    2: np.dtype('<u4'),
+    3: np.dtype('u1'),
+}
+
+
+def _pad8(n):
+    return (n + 7) & ~7
+
+
+def _resolve_path(path):
+    if path is not None:
+        return path
+    for candidate in (DEFAULT_BINARY, DEFAULT_CSV):
+        if os.path.exists(candidate):
+            return candidate
+    raise FileNotFoundError(DEFAULT_BINARY)
+
+
+def is_binary_log(path):
+    with open(path, 'rb') as f:
+        return f.read(len(FILE_MAGIC)) == FILE_MAGIC
+
+
+def read_header(buf):
+    """Restituisce (version, [(nome, dtype)], header_bytes)."""
+    if bytes(buf[:len(FILE_MAGIC)]) != FILE_MAGIC:
+        raise ValueError('non e\' un file di telemetria TDoA')
+    version, num_columns, _rows_per_block, header_bytes = struct.unpack_from('<4I', buf, 8)
+    columns = []
+    offset = 24
+    for _ in range(num_columns):
+        name = bytes(buf[offset:offset + NAME_LEN]).split(b'\0', 1)[0].decode('ascii')
+        col_type, _elem_size = struct.unpack_from('<2I', buf, offset + NAME_LEN)
+        columns.append((name, _DTYPES[col_type]))
+        offset += NAME_LEN + 8
+    return version, columns, header_bytes
+
+
+def iter_blocks(buf, columns, offset):
+    """Per ogni blocco restituisce un dict nome -> array numpy (vista sul buffer)."""
+    while offset + 16 <= len(buf):
+        magic, num_rows, payload = struct.unpack_from('<IIQ', buf, offset)
+        if magic != BLOCK_MAGIC:
+            raise ValueError(f'blocco corrotto all\'offset {offset}')
+        pos = offset + 16
+        block = {}
+        for name, dtype in columns:
+            block[name] = np.frombuffer(buf, dtype=dtype, count=num_rows, offset=pos)
+            pos += _pad8(num_rows * dtype.itemsize)
+        yield block
+        offset += 16 + payload
+
+
+def read_block_index(buf, header_bytes):
+    """Blocchi di un file versione 2: lista di (t_min, t_max, offset, num_rows).
+
+    Usa l'indice in coda al file; se manca (run interrotta) scorre le intestazioni dei blocchi.
+    """
+    if len(buf) >= header_bytes + 16:
+        magic, num_blocks, index_offset = struct.unpack_from('<IIQ', buf, len(buf) - 16)
+        if magic == INDEX_MAGIC and index_offset + 32 * num_blocks + 16 == len(buf):
+            return [struct.unpack_from('<ddQI', buf, index_offset + 32 * i) for i in range(num_blocks)]
+    blocks = []
+    offset = header_bytes
+    while offset + 32 <= len(buf):
+        magic, num_rows, payload = struct.unpack_from('<IIQ', buf, offset)
+        if magic != COMPRESSED_BLOCK_MAGIC or offset + 16 + payload > len(buf):
+            break
+        t_min, t_max = struct.unpack_from('<dd', buf, offset + 16)
+        blocks.append((t_min, t_max, offset, num_rows))
+        offset += 16 + payload
+    return blocks
+
+
+def _decode_column(data, encoding, dtype, num_rows):
+    if encoding == ENC_RAW:
+        return np.frombuffer(data, dtype=dtype, count=num_rows)
+    # Byte k di tutte le righe consecutivi: si ritraspone e si annulla XOR o differenza
+    size = dtype.itemsize
+    raw = np.frombuffer(data, dtype=np.uint8, count=num_rows * size).reshape(size, num_rows).T.copy()
+    words = raw.view('<u%d' % size).ravel()
+    if encoding == ENC_XOR_SHUFFLE:
+        values = np.bitwise_xor.accumulate(words)
+    elif encoding == ENC_DELTA_SHUFFLE:
+        values = np.cumsum(words, dtype=words.dtype)
+    else:
+        raise ValueError(f'codifica di colonna sconosciuta {encoding}')
+    return values.view(dtype)
+
+
+def iter_compressed_blocks(buf, columns, header_bytes, t_start=None, t_end=None, names=None):
+    """Come iter_blocks per la versione 2: decomprime solo i blocchi nella finestra [t_start, t_end]
+    e solo le colonne in names (tutte se None)."""
+    num_columns = len(columns)
+    for t_min, t_max, offset, num_rows in read_block_index(buf, header_bytes):
+        if (t_start is not None and t_max < t_start) or (t_end is not None and t_min > t_end):
+            continue
+        magic, rows, _payload = struct.unpack_from('<IIQ', buf, offset)
+        if magic != COMPRESSED_BLOCK_MAGIC or rows != num_rows:
+            raise ValueError(f'blocco corrotto all\'offset {offset}')
+        layout = struct.unpack_from('<%dI' % (2 * num_columns), buf, offset + 32)
+        pos = offset + 32 + 8 * num_columns
+        block = {}
+        for c, (name, dtype) in enumerate(columns):
+            encoding, stored = layout[2 * c], layout[2 * c + 1]
+            if names is None or name in names:
+                data = zlib.decompress(buf[pos:pos + stored])
+                block[name] = _decode_column(data, encoding, dtype, num_rows)
+            pos += _pad8(stored)
+        yield block
+
+
+def load_columns(path=None, t_start=None, t_end=None, columns=None):
+    """Mappa il file .tlm e restituisce un dict nome colonna -> array numpy.
+
+    t_start/t_end limitano le righe alla finestra di tempo di simulazione, columns alle colonne
+    indicate (la colonna time viene comunque letta se serve per la finestra).
+    """
+    path = _resolve_path(path)
+    with open(path, 'rb') as f:
+        buf = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+    version, all_columns, header_bytes = read_header(buf)
+    wanted = None if columns is None else set(columns)
+    windowed = t_start is not None or t_end is not None
+    read = None if wanted is None else wanted | ({'time'} if windowed else set())
+    selected = [(name, dtype) for name, dtype in all_columns if read is None or name in read]
+    if version >= 2:
+        blocks = list(iter_compressed_blocks(buf, all_columns, header_bytes, t_start, t_end, read))
+    else:
+        blocks = list(iter_blocks(buf, all_columns, header_bytes))
+
+    if len(blocks) == 1:
+        result = blocks[0]
+    else:
+        result = {}
+        for name, dtype in selected:
+            parts = [b[name] for b in blocks]
+            result[name] = np.concatenate(parts) if parts else np.empty(0, dtype=dtype)
+
+    if windowed and len(result.get('time', ())) > 0:
+        time = result['time']
+        mask = np.ones(len(time), dtype=bool)
+        if t_start is not None:
+            mask &= time >= t_start
+        if t_end is not None:
+            mask &= time <= t_end
+        result = {name: values[mask] for name, values in result.items()}
+    if wanted is not None:
+        result = {name: values for name, values in result.items() if name in wanted}
+    return result
+
+
+def read_log(path=None, t_start=None, t_end=None, columns=None):
+    """Sostituto di pd.read_csv per la telemetria: accetta sia .tlm che .csv.
+
+    Con t_start/t_end e columns legge solo la finestra e le colonne indicate (vedi load_columns).
+    """
+    path = _resolve_path(path)
+    if not is_binary_log(path):
+        df = pd.read_csv(path)
+        if t_start is not None:
+            df = df[df['time'] >= t_start]
+        if t_end is not None:
+            df = df[df['time'] <= t_end]
+        return df if columns is None else df[list(columns)]
+    return pd.DataFrame(load_columns(path, t_start, t_end, columns), copy=False)
@@ -6,7 +6,15 @@
  * 
  * Content of the Directory:
  * La cartella è divisa in diversi file:
- * tdoa_main:           è il file principale in cui avviene la simulazione, il metodo TDMAScheduler gestisce tutta la logica temporale (Round Robin)
+ * tdoa_main:           è il file principale: legge le opzioni (--scenario, --seed, formato del log...) e lancia una SwarmSimulation.
+ * SwarmSimulation.cpp/h, Scenario.cpp/h: costruzione della run a partire dallo scenario (default = valori storici: 6 droni, 300 s,
+ *                      attacco a 200 s). Tutti i generatori casuali derivano da scenario.seed, quindi una run e' riproducibile.
+ * TDMAScheduler.cpp/h: gestisce tutta la logica temporale (Round Robin).
+ * tdoa_batch.cpp:      runner Monte Carlo: tante repliche indipendenti (una per seme) su tutti i core, con statistiche aggregate.
+ *                      Non dipende da ns-3: ogni replica gira su un thread con il proprio EventLoop.
+ * SimClock.h, EventLoop.cpp/h, Ns3Clock.cpp/h: orologio e coda eventi della simulazione. La logica dello sciame vede solo SimClock;
+ *                      EventLoop e' il motore interno a eventi discreti, Ns3Clock lo adatta al Simulator di ns-3.
+ *                      Con --engine=native anche tdoa_main usa l'EventLoop (stessi risultati, nessun overhead del Simulator).
  *           Main
  *                  1.  Inizializzo il canale di comunicazione Ultra-WideBand (UWB) settando l'environment 'outdoor', il settaggio del tipo di 
  *                      ambiente modifica semplicemente il coefficiente di Packet Loss, se siamo al chiuso le distanze saranno minori e quindi anche 
@@ -17,20 +25,40 @@
  *                      positiva la variabile booleana 'is_malicious' del drone 0 al tempo 200. Ogni drone è composto di un clock drift che sfaserà di pochi 
  *                      nanosecodi l'orologio del drone. Al dorne 0 viene settato un clockdrift fisso per controllare meglio il comportamento. Ogni drone 
  *                      dalla classe Trajecotry riceverà le coordinate di posizionamento a seconda della forma dello sciame, come spiegato nel paper
- *                      la forma migliore è la ottaedro. Dopo aver pianificato gli aggiornamenti della posizione di ogni drone ogni 0,05s inizio con la 
- *                      simulazione.
+ *                      la forma migliore è la ottaedro. Le traiettorie vivono nel KinematicsEngine, che calcola la posizione di un drone solo quando
+ *                      serve e all'istante esatto dello slot: nessun evento periodico di aggiornamento da pianificare prima della simulazione.
  *                  3.  Simulazione. Start() fa partire lo schedulerNexSlot, che a sua volta fa partire 'ExecuteSlot'  
+ *                      Con --parallel=true la valutazione dei link e l'aggiornamento degli osservatori di ogni slot vengono
+ *                      distribuiti su un WorkerPool persistente (WorkerPool.cpp/h); il tally SwarmRaft resta seriale.
  *                  4.  Sincronizzazione: Se il trasmettitore è il Master Anchor (ID 1), i ricevitori correggono il proprio offset temporale.
  *                  5.  Logica di Sicurezza (SwarmRaft): I droni scambiano le stime e una bitmask di voti. Se un drone riceve troppi voti negativi (ovvero
  *                      i vicini rilevano incoerenza tra la sua posizione GPS dichiarata e quella stimata via TDoA), il sistema forza una correzione della 
  *                      sua posizione (`ResetState`) usando le mediane del gruppo, mitigando l'attacco spoofing.
  * 
- * Drone.cpp/h:         Definisce l'agente dello sciame. Ogni drone mantiene una "banca" di Extended Kalman Filters (`m_my_ekf_bank`) per tracciare la posizione
- *                      di tutti gli altri membri dello sciame. Contiene la logica di rilevamento anomalie: se la distanza tra il GPS dichiarato da un vicino 
- *                      e la stima locale supera una soglia (10m), il drone alza un flag di allarme nella sua `vote_bitmask`.
+ * Drone.cpp/h:         Definisce l'agente dello sciame. Ogni drone usa una "banca" di Extended Kalman Filters per tracciare la posizione
+ *                      di tutti gli altri membri dello sciame (la sua riga della `SwarmFilterBank` condivisa). Contiene la logica di rilevamento anomalie: se la distanza tra il GPS dichiarato da un vicino 
+ *                      e la stima locale supera una soglia (10m), il drone alza un flag di allarme nel suo set di voti (`UWBMessage::votes`).
  *    
  * Trajectories.cpp/h:  Fornisce le leggi di moto per i droni. Ho implementato diverse formazioni, ma quella utilizzata principalmente è l'Ottaedro poichè 
  *                      garantisce la miglior efficienza geometrica (GDOP) in cui tutti i nodi hanno la stessa distanza e angoli gli uni dagli altri.
+ *                      Le formazioni sono tabelle di parametri (TrajectoryTable) valutate per tutto lo sciame in un solo passaggio; si sceglie
+ *                      con `formation = octahedron | atomic_shell | circular_patrol` nel file di scenario.
+ * 
+ * SwarmFilterBank.cpp/h: Tutti gli EKF (osservatore, target) dello sciame in array contigui (Structure-of-Arrays). In ogni slot
+ *                      gli osservatori del trasmettitore corrente vengono aggiornati insieme con un kernel vettorializzato.
+ * 
+ * SpatialGrid.cpp/h:   Griglia uniforme sulle posizioni dei droni, ricostruita ogni 50 ms di simulazione. Con `uwb_range` / `max_neighbors`
+ *                      nello scenario lo scheduler la usa per limitare ogni slot ai ricevitori in portata (o ai k piu' vicini).
+ * 
+ * TransmitterColoring.cpp/h: con tdma_mode = spatial_reuse divide i trasmettitori in gruppi senza ricevitori in comune
+ *                      (colorazione greedy del grafo dei conflitti): ogni slot serve un gruppo intero invece di un solo drone.
+ *                      Con tdma_mode = adaptive gli slot vanno invece ai droni piu' incerti o sospetti (covarianza, innovazione
+ *                      e allarmi dei filtri che li tracciano); --scheduleLog=file.csv registra ogni decisione.
+ * 
+ * ObstacleBVH.cpp/h:   BVH sugli ostacoli sferici dello scenario: UWBChannel la usa per rendere NLOS i link che li attraversano.
+ * 
+ * SwarmConsensus.h:    Voti SwarmRaft in bitset impacchettati dimensionati a runtime (nessun limite a 32 droni) con il conteggio
+ *                      degli allarmi per target aggiornato a ogni cambio di flag: il voto sul trasmettitore si legge in O(1).
  * 
  * TDoAEKF.cpp/h, 
  * UWBChannel.cpp/h:    Sono classi custom realizzate esclusivamente per simulare componenti hardware nel più realistico dei modi. Non esistno moduli
@@ -39,10 +67,39 @@
  *                      una classe UWB implementabile con i nodi di ns-3. In Ns-3 ci sono moduli wifi ecc.. ma non mi permattevano di personalizzarli 
  *                      a mio piacimento (o per mia mancate competenze).
  * 
- * SimulationLogger.h:  Classe di supporto che raccoglie: (posizioni vere, stimate, GPS spoofato e stato degli allarmi) e li scrive 
- *                      su un file CSV (`tdma_security_log.csv`) per la post-elaborazione con gli script Python.
+ * SimulationLogger.h:  Classe di supporto che raccoglie: (posizioni vere, stimate, GPS spoofato e stato degli allarmi) e li passa 
+ *                      a un TelemetrySink per la post-elaborazione con gli script Python.
+ * 
+ * TelemetryWriter.cpp/h: Sink della telemetria. Di default il formato binario colonnare `tdma_security_log.tlm` (mappabile in memoria,
+ *                      letto da tdoa_log.py), con --logFormat=csv il vecchio `tdma_security_log.csv`. --logFormat=compressed
+ *                      scrive lo stesso .tlm a blocchi compressi (XOR/differenza + zlib) con un indice per tempo di simulazione;
+ *                      --logMantissaBits=24 arrotonda stime ed errori per comprimere ancora.
+ *                      Con --asyncLog=true (AsyncTelemetrySink.cpp/h) la scrittura avviene su un thread separato.
+ * 
+ * SlotRecord.cpp/h, ReplayEngine.cpp/h, tdoa_replay.cpp: con --recordSlots=file.slots ogni slot (trasmettitore, GPS dichiarato,
+ *                      misure di ToA) viene registrato; tdoa_replay fa passare un file di slot (registrato o convertito dai
+ *                      dati di volo) nella stessa pipeline EKF + voto + recupero, letto a blocchi e alla massima velocita'.
+ * 
+ * Multilateration.cpp/h: fix di posizione in forma chiusa (Bancroft + Gauss-Newton) dalle misure di un solo slot; con
+ *                      filter_init = multilateration inizializza e reinizializza gli EKF al posto del GPS dichiarato.
+ * 
+ * ClockFilter.cpp/h:  con clock_sync = filter ogni drone stima offset e skew del proprio clock (Kalman a due stati) da tutti
+ *                      i messaggi in LOS, con il Master Anchor come riferimento: il suo slot torna a portare ranging.
+ * 
+ * MetricsAggregator.cpp/h: con --metrics=run_metrics.json gli indicatori (RMSE, quantili dell'errore, tasso di allarmi, voti,
+ *                      errore di recupero, latenza di rilevamento dal SetMalicious) si calcolano in streaming durante la run,
+ *                      per coppia (sender, observer) e per finestra di --metricsWindow secondi; con --logFormat=none il log
+ *                      per osservazione non viene scritto affatto.
  * 
- * plot_tdoa.py,        Script che raccolgono le coordinate dal file tdma_security_log.csv, permettendomi di ricavare informazioni grafiche e non dal sistema
+ * Checkpoint.cpp/h:    con --checkpointAt=T lo stato completo della run (cinematica, droni, banca EKF, consenso, generatori
+ *                      casuali, scheduler) viene salvato in un file; --restore (solo con --engine=native) riprende da li'
+ *                      con gli stessi risultati della run intera, anche con uno scenario diverso (es. un altro attacco).
+ * 
+ * SlotProfiler.cpp/h:  Compilando con TDOA_PROFILE (cmake -DTDOA_PROFILE=ON) lo scheduler misura ogni fase dello slot (canale,
+ *                      sincronizzazione dei clock, update EKF, voto, log) in istogrammi di latenza stile HDR; a fine run
+ *                      vengono stampati percentili e margine rispetto al budget di slot_duration. Senza l'opzione costo zero.
+ * 
+ * plot_tdoa.py,        Script che raccolgono le coordinate dalla telemetria (tramite tdoa_log.py), permettendomi di ricavare informazioni grafiche e non dal sistema
  * plot_old.py,         Dato che non ho molta esperienza in python mi sono fatto aiutare da un LLM.
  * test_swarm_voting.py
  *             
@@ -54,197 +111,205 @@
 #include "ns3/wifi-module.h"
 #include "ns3/mobility-module.h"
 
-#include "Drone.h"
-#include "UWBChannel.h"
-#include "Trajectories.h"
-#include "SimulationLogger.h" 
-#include "UWBMessage.h"
+#include "Scenario.h"
+#include "SwarmSimulation.h"
+#include "Ns3Clock.h"
+#include "TelemetryWriter.h"
+#include "AsyncTelemetrySink.h"
+#include "WorkerPool.h"
 
-#include <vector>
 #include <fstream>
 #include <iostream>
 #include <random>
+#include <memory>
+#include <algorithm>
+#include <thread>
 
 using namespace ns3;
 using namespace std;
-using namespace Eigen;
-
-const int NUM_DRONES = 6;        
-const double SLOT_DURATION = 0.005;
-const double SIM_TIME = 300.0;    
-const double TIME_OF_MALICIOUS = 200.0;
-const int MASTER_ANCHOR_ID = 1;
-
-class TDMAScheduler {
-public:
-    TDMAScheduler(vector<Ptr<Drone>>& swarm, Ptr<UWBChannel> channel, SimulationLogger& logger, ofstream& csv)
-        : m_swarm(swarm), m_channel(channel), m_logger(logger), m_csv(csv), m_current_slot_idx(0) {}
-
-    void Start() {
-        ScheduleNextSlot();
-    }
-
-private:
-    void ScheduleNextSlot() {
-        Simulator::Schedule(Seconds(SLOT_DURATION), &TDMAScheduler::ExecuteSlot, this);
-    }
-
-    void ExecuteSlot() {
-        double now = Simulator::Now().GetSeconds();
-        if(now > SIM_TIME) return;
-
-        int tx_id = m_current_slot_idx % m_swarm.size();
-        Ptr<Drone> sender = m_swarm[tx_id];
-        
-        UWBMessage msg = sender->CreateTDMAMessage();
-        Vector3d tx_true_pos = sender->GetTruePosition(); 
-        double tx_time_sec = msg.tx_timestamp_ps / 1e12; 
-        vector<RangingMeasurement> shared_data_packet; 
-        for(size_t i = 0; i < m_swarm.size(); ++i) {
-            if((int)i == tx_id) continue; 
-
-            Ptr<Drone> rx = m_swarm[i];
-            Vector3d rx_pos_phys = rx->GetTruePosition();
-            
-            ChannelCondition cond = m_channel->ComputeChannelCondition(tx_true_pos, rx_pos_phys, 0.0);
-            double dist = (tx_true_pos - rx_pos_phys).norm();
-            double c = 299792458.0;
-            double tof = dist / c;
-            double rx_drift_physical = rx->GetClockDrift() * 1e-9; 
-            double measured_toa_raw = now + tof + (cond.ranging_error_m / c) + rx_drift_physical;
-
-            if (tx_id == MASTER_ANCHOR_ID) {
-                double geo_dist = (msg.gps_position - rx->GetGPSPosition()).norm();
-                double expected_tof = geo_dist / c;
-                
-                double expected_arrival = tx_time_sec + expected_tof;
-                double clock_error = measured_toa_raw - expected_arrival;
-
-                double current_offset = rx->GetClockOffset();
-                rx->SetClockOffset(current_offset * 0.2 + clock_error * 0.8);
-                continue; 
-            }
-            double corrected_toa = measured_toa_raw - rx->GetClockOffset();
-            RangingMeasurement m;
-            m.target_id = tx_id;
-            m.anchor_id = i;
-            m.anchor_pos = rx->GetGPSPosition(); 
-            m.toa_seconds = corrected_toa; 
-            m.is_los = cond.is_los;
-            
-            shared_data_packet.push_back(m);
-        }
-
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        std::uniform_real_distribution<> drop_chance(0.0, 1.0);
-        double packet_loss_rate = 0.10;
-
-        for(auto& drone : m_swarm) {
-            if((int)drone->GetId() == tx_id) continue;
-
-            vector<RangingMeasurement> drone_specific_buffer;
-            for(const auto& m : shared_data_packet) {
-                if(m.anchor_id == drone->GetId()) {
-                    drone_specific_buffer.push_back(m);
-                } else {
-                    if(drop_chance(gen) > packet_loss_rate) {
-                        drone_specific_buffer.push_back(m);
-                    }
-                }
-            }
-            drone->ComputeNeighborPosition(tx_id, msg.gps_position, drone_specific_buffer, now, tx_time_sec);
-        }
 
-// --- (SWARMRAFT) ---       
-        std::map<int, Vector3d> peer_estimates;
-        int total_votes = 0;
-        for(auto& drone : m_swarm) {
-            int observer_id = drone->GetId();
-            if(observer_id == tx_id) continue;
-            peer_estimates[observer_id] = drone->GetEstimatedPositionOf(tx_id);
-            uint32_t mask = drone->GetVoteBitmask(); 
-            bool vote_bit = (mask >> tx_id) & 1; 
-            total_votes += (vote_bit ? 1 : -1); 
-        }
-        Vector3d recovered_pos;
-        if (total_votes <= -3) { 
-            recovered_pos = m_swarm[0]->GetRecoveredPosition(tx_id, peer_estimates);
-			m_swarm[tx_id]->ResetState(recovered_pos);
-        } else {
-            recovered_pos = msg.gps_position;
-        }
-        for(size_t i = 0; i < m_swarm.size(); ++i) {
-            if((int)i == tx_id) continue;
-            m_logger.LogObservation(now, tx_id, i, msg.gps_position, recovered_pos, m_csv);
-        }
+int main(int argc, char* argv[]) {
+    string scenario_file = "";
+    uint64_t seed = 0;
+    string log_format = "binary";
+    uint32_t log_mantissa_bits = ColumnarTelemetryWriter::FULL_MANTISSA_BITS;
+    bool async_log = false;
+    uint32_t log_queue = 65536;
+    string log_policy = "block";
+    uint32_t log_sample_every = 10;
+    bool parallel = false;
+    uint32_t num_threads = 0;
+    string engine = "ns3";
+    string record_slots = "";
+    string schedule_log = "";
+    double checkpoint_at = -1.0;
+    string checkpoint_out = "tdoa.ckpt";
+    string restore = "";
+    string metrics_file = "";
+    double metrics_window = 10.0;
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("scenario", "File di scenario (chiave = valore, vedi Scenario.h)", scenario_file);
+    cmd.AddValue("seed", "Seme della run (0 = casuale, quello usato viene stampato)", seed);
+    cmd.AddValue("logFormat", "Formato della telemetria: binary (tdma_security_log.tlm), compressed (.tlm a blocchi compressi), csv (tdma_security_log.csv) o none", log_format);
+    cmd.AddValue("logMantissaBits", "Con --logFormat=compressed: bit di mantissa tenuti nelle colonne double (52 = senza perdite)", log_mantissa_bits);
+    cmd.AddValue("asyncLog", "Scrive la telemetria da un thread separato tramite una coda limitata", async_log);
+    cmd.AddValue("logQueue", "Capacita' della coda del log asincrono (record)", log_queue);
+    cmd.AddValue("logPolicy", "Back-pressure del log asincrono a coda piena: block, drop o sample", log_policy);
+    cmd.AddValue("logSampleEvery", "Con logPolicy=sample tiene un record ogni N quando la coda e' oltre meta'", log_sample_every);
+    cmd.AddValue("parallel", "Processa canale e osservatori di ogni slot in parallelo (risultati identici al seriale)", parallel);
+    cmd.AddValue("threads", "Thread del pool per --parallel (0 = tutti i core)", num_threads);
+    cmd.AddValue("engine", "Motore a eventi: ns3 (Simulator di ns-3) o native (EventLoop interno)", engine);
+    cmd.AddValue("recordSlots", "Registra gli slot (GPS dichiarato + misure) in un file per tdoa_replay", record_slots);
+    cmd.AddValue("scheduleLog", "CSV delle decisioni dello scheduler (tdma_mode = adaptive nello scenario)", schedule_log);
+    cmd.AddValue("checkpointAt", "Salva un checkpoint della run a questo istante (s, -1 = mai)", checkpoint_at);
+    cmd.AddValue("checkpointOut", "File del checkpoint scritto con --checkpointAt", checkpoint_out);
+    cmd.AddValue("restore", "Riprende la run da un checkpoint (richiede --engine=native)", restore);
+    cmd.AddValue("metrics", "Riepilogo JSON degli indicatori calcolati in streaming durante la run", metrics_file);
+    cmd.AddValue("metricsWindow", "Ampiezza delle finestre temporali del riepilogo --metrics (s)", metrics_window);
+    cmd.Parse(argc, argv);
 
-        m_current_slot_idx++;
-        ScheduleNextSlot();
+    AsyncTelemetrySink::BackPressure policy;
+    if (!AsyncTelemetrySink::ParsePolicy(log_policy, policy)) {
+        cerr << "logPolicy non valida: " << log_policy << endl;
+        return 1;
+    }
+    if (log_format != "binary" && log_format != "compressed" && log_format != "csv" && log_format != "none") {
+        cerr << "logFormat non valido: " << log_format << " (binary, compressed, csv o none)" << endl;
+        return 1;
     }
 
-    vector<Ptr<Drone>>& m_swarm;
-    Ptr<UWBChannel> m_channel;
-    SimulationLogger& m_logger;
-    ofstream& m_csv;
-    int m_current_slot_idx;
-};
+    // Con --engine=native la SwarmSimulation usa il proprio EventLoop (serve per --restore)
+    unique_ptr<SimClock> clock;
+    if (engine == "ns3") clock = make_unique<Ns3Clock>();
+    else if (engine != "native") {
+        cerr << "engine non valido: " << engine << endl;
+        return 1;
+    }
+    if (!restore.empty() && clock) {
+        cerr << "--restore richiede --engine=native" << endl;
+        return 1;
+    }
 
-int main(int argc, char* argv[]) {
-    
-    Ptr<UWBChannel> channel = CreateObject<UWBChannel>();
-    channel->SetEnvironment("outdoor"); 
+    Scenario scenario;
+    if (!scenario_file.empty()) {
+        string error;
+        if (!scenario.LoadFile(scenario_file, error)) {
+            cerr << error << endl;
+            return 1;
+        }
+    }
+    if (seed != 0) scenario.seed = seed;
+    string scenario_error;
+    if (!scenario.Validate(scenario_error)) {
+        cerr << scenario_error << endl;
+        return 1;
+    }
+    if (scenario.seed == 0) {
+        std::random_device rd;
+        scenario.seed = ((uint64_t)rd() << 32) | rd();
+    }
 
-    vector<Ptr<Drone>> swarm;
-    for(int i = 0; i < NUM_DRONES; ++i) {
-        Ptr<Drone> d = CreateObject<Drone>();
-        d->SetId(i);
-        swarm.push_back(d);
+    SwarmSimulation sim(scenario, clock.get());
+    if (!restore.empty()) {
+        string error;
+        if (!sim.LoadCheckpoint(restore, error)) {
+            cerr << error << endl;
+            return 1;
+        }
+        cout << ">>> Restored checkpoint " << restore << endl;
     }
+    cout << ">>> Finish Configuration. (" << scenario.num_drones << " drones, seed " << scenario.seed << ")" << endl;
 
-    swarm[0]->SetTrajectory(GetTargetTrajectory());
-    swarm[0]->SetMalicious(false);
-    swarm[0]->SetClockDrift(10000.0); 
-    cout << ">>> Finish Configuration." << endl;
+    // Con --logFormat=none nessun log per osservazione: restano gli indicatori (--metrics)
+    unique_ptr<TelemetrySink> sink;
+    if (log_format == "csv") {
+        auto csv = make_unique<CsvTelemetryWriter>("tdma_security_log.csv");
+        if(!csv->IsOpen()) return 1;
+        sink = std::move(csv);
+    } else if (log_format != "none") {
+        auto codec = log_format == "compressed" ? ColumnarTelemetryWriter::CODEC_ZLIB : ColumnarTelemetryWriter::CODEC_NONE;
+        // Una riga per ricevitore e in uno slot ogni drone riceve al piu' un trasmettitore (anche con spatial_reuse)
+        uint64_t max_rows = (uint64_t)(scenario.sim_time / scenario.slot_duration + 1) * scenario.num_drones;
+        auto tlm = make_unique<ColumnarTelemetryWriter>("tdma_security_log.tlm", ColumnarTelemetryWriter::DEFAULT_ROWS_PER_BLOCK, codec,
+                                                            log_mantissa_bits, max_rows);
+        if(!tlm->IsOpen()) return 1;
+        sink = std::move(tlm);
+    }
 
-    std::mt19937 init_rng(1234); 
-    std::uniform_real_distribution<> drift_dist(-500.0, 500.0);
+    unique_ptr<AsyncTelemetrySink> async_sink;
+    if (async_log && sink) async_sink = make_unique<AsyncTelemetrySink>(*sink, log_queue, policy, log_sample_every);
+    sim.SetTelemetrySink(async_sink ? async_sink.get() : sink.get());
 
-    for(int i = 1; i < NUM_DRONES; ++i) 
-    {
-        swarm[i]->SetTrajectory(GetAnchorTrajectory(i, NUM_DRONES)); 
-        swarm[i]->SetMalicious(false);
-        double d = drift_dist(init_rng);
-        swarm[i]->SetClockDrift(d);
+    unique_ptr<MetricsAggregator> metrics;
+    if (!metrics_file.empty()) {
+        metrics = make_unique<MetricsAggregator>(scenario.num_drones, scenario.sim_time, metrics_window);
+        sim.SetMetrics(metrics.get());
     }
 
-    for(double t=0; t<=SIM_TIME; t+=0.05) 
-    {
-        Simulator::Schedule(Seconds(t), [swarm, t]()
-        {
-            for(auto& d : swarm) d->UpdatePosition(t);
-        });
+    unique_ptr<SlotRecordWriter> recorder;
+    if (!record_slots.empty()) {
+        recorder = make_unique<SlotRecordWriter>(record_slots, scenario.num_drones);
+        if (!recorder->IsOpen()) return 1;
+        sim.SetSlotRecorder(recorder.get());
     }
-    
-    Simulator::Schedule(Seconds(TIME_OF_MALICIOUS), [swarm]()
-	{
-        swarm[0]->SetMalicious(true); 
-        std::cout << ">>> ATTACK ACTIVATED: drone GPS spoofing <0> starts at t="<< TIME_OF_MALICIOUS <<"s <<<" << std::endl;
-	});
 
-    ofstream csv("tdma_security_log.csv");
-    if(!csv.is_open()) return 1;
-    csv << "time,sender_id,observer_id,est_x,est_y,est_z,claim_x,claim_y,claim_z,true_x,true_y,true_z,discrepancy,estimation_error,alarm,rec_x,rec_y,rec_z\n";
+    ofstream schedule_out;
+    if (!schedule_log.empty()) {
+        schedule_out.open(schedule_log);
+        if (!schedule_out.is_open()) {
+            cerr << "cannot write " << schedule_log << endl;
+            return 1;
+        }
+        sim.SetScheduleLog(&schedule_out);
+    }
 
-    SimulationLogger logger(swarm);
-    TDMAScheduler scheduler(swarm, channel, logger, csv);
+    unique_ptr<WorkerPool> pool;
+    if (parallel) {
+        if (num_threads == 0) num_threads = std::max(1u, std::thread::hardware_concurrency());
+        pool = make_unique<WorkerPool>(num_threads);
+        sim.SetWorkerPool(pool.get());
+        cout << ">>> Intra-slot parallel mode: " << pool->GetNumThreads() << " threads." << endl;
+    }
 
     cout << "--- Start Simulation RR-TDoA ---" << endl;
     
-    scheduler.Start();
-    Simulator::Stop(Seconds(SIM_TIME));
-    Simulator::Run();
-    Simulator::Destroy();
+    sim.Start();
+    if (checkpoint_at >= 0 && checkpoint_at < scenario.sim_time) {
+        if (checkpoint_at >= scenario.time_of_malicious)
+            cout << ">>> Warning: checkpoint after the attack, variants restored from it share the attack" << endl;
+        sim.RunUntil(checkpoint_at);
+        string error;
+        if (!sim.SaveCheckpoint(checkpoint_out, error)) {
+            cerr << error << endl;
+            return 1;
+        }
+        cout << ">>> Checkpoint at t=" << checkpoint_at << " s written to " << checkpoint_out << endl;
+    }
+    sim.RunUntil(scenario.sim_time);
+    const RunStats& stats = sim.GetStats();
+    if (async_sink) {
+        async_sink->Close();
+        AsyncTelemetrySink::Stats st = async_sink->GetStats();
+        cout << "--- Async log: written " << st.written << ", dropped " << st.dropped
+             << ", sampled out " << st.sampled_out << ", max queue depth " << st.max_queue_depth
+             << "/" << st.queue_capacity << " ---" << endl;
+    }
+    if (sink) sink->Flush();
+    if (recorder) recorder->Flush();
+    if (SlotProfiler::Enabled()) {
+        cout << "--- Slot profile (TDOA_PROFILE) ---" << endl;
+        sim.GetProfiler().Print(cout);
+    }
+    cout << "--- RMSE " << stats.Rmse() << " m, alarm latency " << stats.AlarmLatency()
+         << " s, false alarm rate " << stats.FalseAlarmRate() << ", recovery error " << stats.RecoveryError() << " m ---" << endl;
+    if (metrics) {
+        string error;
+        if (!metrics->WriteSummary(metrics_file, error)) {
+            cerr << error << endl;
+            return 1;
+        }
+        cout << "--- Metrics summary in " << metrics_file << " ---" << endl;
+    }
     cout << "--- End. ---" << endl;
     cout << "--- For Result, see python files. ---" << endl;
     return 0;
@@ -2,12 +2,14 @@ import pandas as pd
 import matplotlib.pyplot as plt
 import numpy as np
 
-def run_swarmraft_analysis(csv_file='tdma_security_log.csv'):
-    # 1. Caricamento dati aggiornati
+from tdoa_log import read_log
+
+def run_swarmraft_analysis(log_file=None):
+    # 1. Caricamento dati aggiornati (.tlm binario o .csv)
     try:
-        df = pd.read_csv(csv_file)
-    except FileNotFoundError:
-        print(f"Errore: {csv_file} non trovato.")
+        df = read_log(log_file)
+    except FileNotFoundError as e:
+        print(f"Errore: {e} non trovato.")
         return
 
     N = df['observer_id'].nunique() + 1